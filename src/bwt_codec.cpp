@@ -1,5 +1,6 @@
 #include "bwt_codec.h"
 
+#include "tools.h"
 #include <vector>
 #include <numeric>
 #include <algorithm>
@@ -7,10 +8,12 @@
 #include <iostream>
 #include <fstream>
 #include <iosfwd>
+#include <atomic>
 #include "../sais/sais.hxx"
 
 
 const uint8_t Bwt::CodecIdentifier = 40;
+const uint32_t Bwt::MaxLanes = 32;
 
 uint8_t Bwt::codecIdentifier() const
 {
@@ -27,137 +30,572 @@ Bwt * Bwt::Create()
 	return new Bwt();
 }
 
-void Bwt::setCompressionParameters(const uint32_t blockSize)
+void Bwt::setDecodeMethod(uint32_t method)
+{
+	m_decodeMethod = method;
+}
+
+void Bwt::setCompressionParameters(const uint32_t blockSize, const uint32_t threadCount, const uint32_t lanes)
 {
 	//clamp to 16MB - 1
 	m_blockSize = blockSize > 16 * 1024 * 1024 - 1 ? 16 * 1024 * 1024 - 1 : blockSize;
+	m_threadCount = threadCount;
+	m_lanes = lanes < 1 ? 1 : (lanes > MaxLanes ? MaxLanes : lanes);
+}
+
+void Bwt::writeHeader(uint8_t * dest, size_t & destIndex, uint64_t sourceSize, uint32_t blockSize, uint32_t lanes)
+{
+	//output source size
+	Tools::writeSize(dest, destIndex, sourceSize);
+	//output BWT block size and format
+	const Format format = lanes > 1 ? Format::SaisLanes : Format::Sais;
+	*((uint32_t *)&dest[destIndex]) = blockSize | (static_cast<uint32_t>(format) << 24);
+	destIndex += 4;
+	//output number of lanes
+	if (format == Format::SaisLanes)
+	{
+		dest[destIndex++] = static_cast<uint8_t>(lanes);
+	}
+}
+
+bool Bwt::readHeader(const uint8_t * source, size_t size, size_t & sourceIndex, uint64_t & destSize, uint32_t & blockSize, Format & format, uint32_t & lanes)
+{
+	//read result size
+	if (Tools::readSize(source, size, sourceIndex, destSize) && sourceIndex + 4 <= size)
+	{
+		//read BWT block size and format
+		blockSize = *((uint32_t *)&source[sourceIndex]) & 0xFFFFFF;
+		format = static_cast<Format>(source[sourceIndex + 3]);
+		sourceIndex += 4;
+		lanes = 1;
+		//read number of lanes
+		if (format == Format::SaisLanes)
+		{
+			if (sourceIndex >= size)
+			{
+				return false;
+			}
+			lanes = source[sourceIndex++];
+		}
+		return blockSize > 0 && lanes >= 1 && lanes <= MaxLanes;
+	}
+	return false;
 }
 
-std::vector<uint8_t> Bwt::encode(const std::vector<uint8_t> & source) const
-{
-	const uint32_t srcSize = static_cast<uint32_t>(source.size());
-	if (srcSize > 0 && m_blockSize > 0)
-	{
-		//allocate destination data
-		std::vector<uint8_t> dest(srcSize + 4 + 4 + 4 * ((srcSize / m_blockSize) + 1));
-		uint32_t destIndex = 0;
-		//output source size
-		*((uint32_t *)&dest[destIndex]) = srcSize;
-		destIndex += 4;
-		//output BWT block size
-		*((uint32_t *)&dest[destIndex]) = m_blockSize;
-		destIndex += 4;
-		//build array of indices into source array
-		std::vector<int32_t> indices(2 * m_blockSize);
-		//allocate array for block data storage and easier access
-		std::vector<uint8_t> block(2 * m_blockSize);
-		//loop through blocks
-		uint32_t srcIndex = 0;
-		while (srcIndex < srcSize)
-		{
-			//clamp block size so we don't read past the end of source
-			const uint32_t size = (srcIndex + m_blockSize) > srcSize ? (srcSize - srcIndex) : m_blockSize;
-			//copy data into block in reverse order and duplicate it. this makes it possible to write the data 
-			//with increasing indices when decoding. also the suffix array algorithm will generate un-decodable data
-			//when using only a single block of data. the generated indices are screwed up.
-			//If you know the correct way to sort the string without needing to duplicate indices, please let me know!
-			std::reverse_copy(std::next(source.cbegin(), srcIndex), std::next(source.cbegin(), srcIndex + size), block.begin());
-			std::reverse_copy(std::next(source.cbegin(), srcIndex), std::next(source.cbegin(), srcIndex + size), std::next(block.begin(), size));
-			//build suffix array from data
- 			saisxx<uint8_t *, int32_t *, int32_t>(block.data(), indices.data(), 2 * size, 256);
-			//store reference to start index for writing it later
-			uint32_t & startIndex = ((uint32_t &)dest[destIndex]);
-			destIndex += 4;
-			//encode data to output while looking for start index
-			uint32_t count = 0;
-			for (uint32_t i = 0; i < 2 * size; ++i)
+void Bwt::encodeBlock(const uint8_t * source, uint32_t size, uint32_t lanes, uint8_t * dest, int32_t * indices, uint8_t * block)
+{
+	if (lanes <= 1)
+	{
+		//copy data into the destination in reverse order. this makes it possible to write the data 
+		//with increasing indices when decoding. the transform is then done in place
+		block = dest + 4;
+		std::reverse_copy(source, source + size, block);
+		//build suffix array of the block with an implicit sentinel and store the transform. the sentinel is left out
+		//of the output, its position is returned instead. it is in [1, size]
+		const int32_t primaryIndex = saisxx_bwt<uint8_t *, int32_t *, int32_t>(block, block, indices, static_cast<int32_t>(size), 256);
+		//store start index
+		*((uint32_t *)&dest[0]) = static_cast<uint32_t>(primaryIndex);
+	}
+	else
+	{
+		//we need the suffix array to find the lanes, so build it and the transform ourselves from the reversed data
+		std::reverse_copy(source, source + size, block);
+		saisxx<uint8_t *, int32_t *, int32_t>(block, indices, static_cast<int32_t>(size), 256);
+		//lane n starts at position n * size / lanes of the original data, which is the suffix starting at size minus that
+		//lanes starting at position 0 (when there are more lanes than symbols) start at data index 0 like lane 0
+		//the lower 8 bits of lane suffixes are marked in a filter, so most rows need only one check
+		std::array<int32_t, MaxLanes> laneSuffixes;
+		std::array<uint8_t, 256> laneFilter;
+		laneFilter.fill(0);
+		uint32_t * laneIndices = (uint32_t *)dest;
+		for (uint32_t lane = 1; lane < lanes; ++lane)
+		{
+			laneSuffixes[lane] = static_cast<int32_t>(size - static_cast<uint64_t>(lane) * size / lanes);
+			laneFilter[laneSuffixes[lane] & 0xFF] = 1;
+			laneIndices[lane] = 0;
+		}
+		uint8_t * data = dest + 4 * lanes;
+		//the first row is the sentinel suffix. it is preceded by the last symbol
+		data[0] = block[size - 1];
+		uint32_t dataIndex = 1;
+		for (uint32_t row = 0; row < size; ++row)
+		{
+			const int32_t suffix = indices[row];
+			if (suffix == 0)
+			{
+				//the sentinel precedes the whole string. leave it out and store its position as the start index
+				laneIndices[0] = row + 1;
+				continue;
+			}
+			//store the data index of the row if a lane starts here
+			if (laneFilter[suffix & 0xFF] != 0)
 			{
-				uint32_t index = static_cast<uint32_t>(indices[i]);
-				//we have duplicated the input data, thus we only need to use indices that are "from the first half"
-				if (index < size)
+				for (uint32_t lane = 1; lane < lanes; ++lane)
 				{
-					//check if we've found the start index
-					if (index == 0)
+					if (suffix == laneSuffixes[lane])
 					{
-						//yes. store it and copy last input symbol to output
-						startIndex = count;
-						index = size;
+						laneIndices[lane] = dataIndex;
 					}
-					//store symbol from input data to output data
-					dest[destIndex++] = block[index - 1];
-					count++;
 				}
 			}
-			//move to next block of input data
-			srcIndex += size;
+			data[dataIndex++] = block[suffix - 1];
 		}
-		dest.resize(destIndex);
-		return dest;
 	}
-	return std::vector<uint8_t>();
+}
+
+size_t Bwt::encodeBound(size_t size) const
+{
+	//size + block size + lanes + start indices for every block
+	return Tools::MaxSizeBytes + 5 + size + 4 * m_lanes * (m_blockSize > 0 ? (size / m_blockSize) + 1 : 0);
+}
+
+size_t Bwt::encodeInto(const uint8_t * source, size_t size, uint8_t * dest, size_t destSize, Workspace & workspace) const
+{
+	const size_t srcSize = size;
+	if (srcSize > 0 && m_blockSize > 0 && destSize >= encodeBound(srcSize))
+	{
+		size_t destIndex = 0;
+		writeHeader(dest, destIndex, srcSize, m_blockSize, m_lanes);
+		//every block is transformed to 4 bytes of start index per lane plus its size, so blocks can be transformed
+		//in parallel, directly to their position in the output
+		const uint64_t nrOfBlocks = (srcSize + m_blockSize - 1) / m_blockSize;
+		const uint32_t nrOfThreads = Tools::parallelThreadCount(static_cast<uint32_t>(std::min<uint64_t>(threadCount(), nrOfBlocks)), threadCount());
+		if (m_verbose && nrOfThreads > 1) { std::cout << "Transforming " << nrOfBlocks << " BWT block(s) using " << nrOfThreads << " thread(s)." << std::endl; }
+		//suffix array and block storage for every thread. never larger than the source
+		const size_t workSize = std::min<size_t>(m_blockSize, srcSize);
+		int32_t * indices = workspace.get<int32_t>(0, nrOfThreads * workSize);
+		uint8_t * blocks = m_lanes > 1 ? workspace.get<uint8_t>(1, nrOfThreads * workSize) : nullptr;
+		//work item n transforms blocks n, n + nrOfThreads, n + 2 * nrOfThreads... using storage n
+		Tools::parallelFor(nrOfThreads, nrOfThreads, [&](uint32_t item, uint32_t /*threadIndex*/)
+		{
+			for (uint64_t blockIndex = item; blockIndex < nrOfBlocks; blockIndex += nrOfThreads)
+			{
+				const size_t srcIndex = static_cast<size_t>(blockIndex * m_blockSize);
+				//clamp block size so we don't read past the end of source
+				const uint32_t blockSize = (srcIndex + m_blockSize) > srcSize ? static_cast<uint32_t>(srcSize - srcIndex) : m_blockSize;
+				//transform block and store start indices and data
+				uint8_t * block = blocks != nullptr ? blocks + item * workSize : nullptr;
+				encodeBlock(source + srcIndex, blockSize, m_lanes, dest + destIndex + srcIndex + blockIndex * 4 * m_lanes, indices + item * workSize, block);
+			}
+		});
+		destIndex += srcSize + nrOfBlocks * 4 * m_lanes;
+		return destIndex;
+	}
+	return 0;
+}
+
+bool Bwt::decodeBlock(Format format, uint32_t method, uint32_t lanes, const uint8_t * block, uint32_t size, uint8_t * dest, uint32_t * T)
+{
+	const uint32_t startIndex = *((uint32_t *)block);
+	if (format == Format::SaisLanes && startIndex >= 1 && startIndex <= size)
+	{
+		//check lane start indices
+		const uint32_t * laneIndices = (const uint32_t *)(block + 4);
+		for (uint32_t lane = 1; lane < lanes; ++lane)
+		{
+			if (laneIndices[lane - 1] >= size)
+			{
+				return false;
+			}
+		}
+		decodeSaisLanesBlock(lanes, laneIndices, block + 4 * lanes, size, startIndex, dest, T);
+		return true;
+	}
+	else if (format == Format::Sais && startIndex >= 1 && startIndex <= size)
+	{
+		decodeSaisBlock(method, block + 4, size, startIndex, dest, T);
+		return true;
+	}
+	else if (format == Format::DoubledBlock && startIndex < size)
+	{
+		decodeDoubledBlock(method, block + 4, size, startIndex, dest, T);
+		return true;
+	}
+	return false;
 }
 
 /// @brief Three BWT-inversion algorithms are described very well in this paper: Space-Time trade-offs in the Burrows-Wheeler transform
 /// Here, a variation of the algorithm "bw94" is used, while the input data has been reversed in the encoder
 /// and thus the output can be written front-to-back in contrary to the original algorithm.
-std::vector<uint8_t> Bwt::decode(const std::vector<uint8_t> & source) const
-{
-	const uint32_t srcSize = static_cast<uint32_t>(source.size());
-	if (srcSize > 0)
-	{
-		//read result size
-		uint32_t srcIndex = 0;
-		const uint32_t destSize = *((uint32_t *)&source[srcIndex]);
-		srcIndex += 4;
-		//allocate destination data
-		std::vector<uint8_t> dest(destSize);
-		uint32_t destIndex = 0;
-		//read BWT block size
-		const uint32_t blockSize = *((uint32_t *)&source[srcIndex]);
-		srcIndex += 4;
-		//array for storing accumulated character frequencies
-		std::vector<uint32_t> C(256);
-		//inverse transform array
-		std::vector<uint32_t> T(blockSize);
-		//loop through blocks
-		while (srcIndex < srcSize)
-		{
-			//read start index from data first
-			const uint32_t startIndex = *((uint32_t *)&source[srcIndex]);
-			srcIndex += 4;
-			//clamp block size so we don't read past the end of source
-			const uint32_t size = (srcIndex + blockSize) > srcSize ? (srcSize - srcIndex) : blockSize;
-			//set up pointer to start of data
-			const uint8_t * blockData = &source[srcIndex];
-			//clear array storing symbol frequency information
-			std::fill(C.begin(), C.end(), 0);
-			//count symbol counts and build inverse transform array
-			for (uint32_t i = 0; i < size; ++i)
+void Bwt::decodeDoubledBlock(uint32_t method, const uint8_t * blockData, uint32_t size, uint32_t startIndex, uint8_t * dest, uint32_t * T)
+{
+	//array storing accumulated symbol frequency information
+	std::array<uint32_t, 256> C;
+	C.fill(0);
+	//count symbol counts and build inverse transform array
+	for (uint32_t i = 0; i < size; ++i)
+	{
+		T[i] = C[blockData[i]]++;
+	}
+	//sum counts
+	for (uint32_t symbol = 1; symbol < 256; ++symbol)
+	{
+		C[symbol] += C[symbol - 1];
+	}
+	//shit counts right
+	for (uint32_t symbol = 255; symbol > 0; --symbol)
+	{
+		C[symbol] = C[symbol - 1];
+	}
+	C[0] = 0;
+	uint32_t index = startIndex;
+	if (method == 0)
+	{
+		//undo the BWT by reading symbol, then looking up next index through transform arrays
+		for (uint32_t i = 0; i < size; ++i)
+		{
+			const uint8_t symbol = blockData[index];
+			dest[i] = symbol;
+			index = T[index] + C[symbol];
+		}
+	}
+	else
+	{
+		//store symbol in the upper 8 bits and next index in the lower 24 bits
+		for (uint32_t i = 0; i < size; ++i)
+		{
+			const uint8_t symbol = blockData[i];
+			T[i] = (static_cast<uint32_t>(symbol) << 24) | (T[i] + C[symbol]);
+		}
+		//undo the BWT with a single lookup per symbol
+		for (uint32_t i = 0; i < size; ++i)
+		{
+			const uint32_t entry = T[index];
+			dest[i] = static_cast<uint8_t>(entry >> 24);
+			index = entry & 0xFFFFFF;
+		}
+	}
+}
+
+/// @brief The transform of the reversed block including the sentinel has size + 1 rows. Row 0 is the sentinel suffix,
+/// so walking the rows backwards from it yields the original block front-to-back. The sentinel row at startIndex
+/// is missing from the data, so rows after it are shifted down by one.
+void Bwt::decodeSaisBlock(uint32_t method, const uint8_t * blockData, uint32_t size, uint32_t startIndex, uint8_t * dest, uint32_t * T)
+{
+	//array storing accumulated symbol frequency information
+	std::array<uint32_t, 256> C;
+	C.fill(0);
+	//count symbol counts and store rank of every symbol
+	for (uint32_t i = 0; i < size; ++i)
+	{
+		T[i] = C[blockData[i]]++;
+	}
+	//sum counts exclusively. the sentinel sorts before all symbols and takes row 0
+	uint32_t sum = 1;
+	for (uint32_t symbol = 0; symbol < 256; ++symbol)
+	{
+		const uint32_t count = C[symbol];
+		C[symbol] = sum;
+		sum += count;
+	}
+	uint32_t index = 0;
+	if (method == 0)
+	{
+		//build inverse transform array pointing to the data index of the previous row
+		for (uint32_t i = 0; i < size; ++i)
+		{
+			const uint32_t row = T[i] + C[blockData[i]];
+			T[i] = row >= startIndex ? row - 1 : row;
+		}
+		//undo the BWT by reading symbol, then looking up next index through transform array
+		for (uint32_t i = 0; i < size; ++i)
+		{
+			dest[i] = blockData[index];
+			index = T[index];
+		}
+	}
+	else
+	{
+		//store symbol in the upper 8 bits and data index of the previous row in the lower 24 bits
+		for (uint32_t i = 0; i < size; ++i)
+		{
+			const uint8_t symbol = blockData[i];
+			const uint32_t row = T[i] + C[symbol];
+			T[i] = (static_cast<uint32_t>(symbol) << 24) | (row >= startIndex ? row - 1 : row);
+		}
+		//undo the BWT with a single lookup per symbol
+		for (uint32_t i = 0; i < size; ++i)
+		{
+			const uint32_t entry = T[index];
+			dest[i] = static_cast<uint8_t>(entry >> 24);
+			index = entry & 0xFFFFFF;
+		}
+	}
+}
+
+/// @brief Same as decodeSaisBlock() with method 1, but lanes of the block are decoded at the same time, each one
+/// following its own chain of indices. The memory accesses of the lanes don't depend on each other, so they overlap.
+void Bwt::decodeSaisLanesBlock(uint32_t lanes, const uint32_t * laneIndices, const uint8_t * blockData, uint32_t size, uint32_t startIndex, uint8_t * dest, uint32_t * T)
+{
+	//array storing accumulated symbol frequency information
+	std::array<uint32_t, 256> C;
+	C.fill(0);
+	//count symbol counts and store rank of every symbol
+	for (uint32_t i = 0; i < size; ++i)
+	{
+		T[i] = C[blockData[i]]++;
+	}
+	//sum counts exclusively. the sentinel sorts before all symbols and takes row 0
+	uint32_t sum = 1;
+	for (uint32_t symbol = 0; symbol < 256; ++symbol)
+	{
+		const uint32_t count = C[symbol];
+		C[symbol] = sum;
+		sum += count;
+	}
+	//store symbol in the upper 8 bits and data index of the previous row in the lower 24 bits
+	for (uint32_t i = 0; i < size; ++i)
+	{
+		const uint8_t symbol = blockData[i];
+		const uint32_t row = T[i] + C[symbol];
+		T[i] = (static_cast<uint32_t>(symbol) << 24) | (row >= startIndex ? row - 1 : row);
+	}
+	//set up lanes. lane n covers [n * size / lanes, (n + 1) * size / lanes) of the output
+	std::array<uint32_t, MaxLanes> index;
+	std::array<uint8_t *, MaxLanes> output;
+	index[0] = 0;
+	output[0] = dest;
+	for (uint32_t lane = 1; lane < lanes; ++lane)
+	{
+		index[lane] = laneIndices[lane - 1];
+		output[lane] = dest + static_cast<uint64_t>(lane) * size / lanes;
+	}
+	//undo the BWT for all lanes at the same time, as long as all lanes have data left
+	const uint32_t laneSize = size / lanes;
+	for (uint32_t i = 0; i < laneSize; ++i)
+	{
+		for (uint32_t lane = 0; lane < lanes; ++lane)
+		{
+			const uint32_t entry = T[index[lane]];
+			output[lane][i] = static_cast<uint8_t>(entry >> 24);
+			index[lane] = entry & 0xFFFFFF;
+		}
+	}
+	//lanes are at most one symbol longer than others. finish them
+	for (uint32_t lane = 0; lane < lanes; ++lane)
+	{
+		uint8_t * laneEnd = lane + 1 < lanes ? output[lane + 1] : dest + size;
+		for (uint8_t * out = output[lane] + laneSize; out < laneEnd; ++out)
+		{
+			const uint32_t entry = T[index[lane]];
+			*out = static_cast<uint8_t>(entry >> 24);
+			index[lane] = entry & 0xFFFFFF;
+		}
+	}
+}
+
+size_t Bwt::decodedSize(const uint8_t * source, size_t size) const
+{
+	size_t srcIndex = 0;
+	uint64_t destSize = 0;
+	return Tools::readSize(source, size, srcIndex, destSize) ? static_cast<size_t>(destSize) : 0;
+}
+
+size_t Bwt::decodeInto(const uint8_t * source, size_t size, uint8_t * dest, size_t destCapacity, Workspace & workspace) const
+{
+	const size_t srcSize = size;
+	//read header
+	size_t srcIndex = 0;
+	uint64_t destSize = 0;
+	uint32_t blockSize = 0;
+	Format format = Format::Sais;
+	uint32_t lanes = 1;
+	if (readHeader(source, srcSize, srcIndex, destSize, blockSize, format, lanes) && destSize > 0 && destSize <= destCapacity)
+	{
+		//every block is stored as 4 bytes of start index per lane plus its size, so we know where all blocks start
+		//and can invert them in parallel, directly to their position in dest
+		const uint64_t nrOfBlocks = (destSize + blockSize - 1) / blockSize;
+		if (srcIndex + nrOfBlocks * 4 * lanes + destSize > srcSize)
+		{
+			return 0;
+		}
+		const uint32_t nrOfThreads = Tools::parallelThreadCount(static_cast<uint32_t>(std::min<uint64_t>(threadCount(), nrOfBlocks)), threadCount());
+		if (m_verbose && nrOfThreads > 1) { std::cout << "Inverting " << nrOfBlocks << " BWT block(s) using " << nrOfThreads << " thread(s)." << std::endl; }
+		//inverse transform array for every thread. never larger than the decoded data
+		const size_t workSize = static_cast<size_t>(std::min<uint64_t>(blockSize, destSize));
+		uint32_t * T = workspace.get<uint32_t>(0, nrOfThreads * workSize);
+		//work item n inverts blocks n, n + nrOfThreads, n + 2 * nrOfThreads... using transform array n
+		std::atomic<bool> blocksDecoded(true);
+		Tools::parallelFor(nrOfThreads, nrOfThreads, [&](uint32_t item, uint32_t /*threadIndex*/)
+		{
+			for (uint64_t blockIndex = item; blockIndex < nrOfBlocks && blocksDecoded; blockIndex += nrOfThreads)
 			{
-				T[i] = C[blockData[i]]++;
+				const uint64_t destIndex = blockIndex * blockSize;
+				const uint8_t * block = source + srcIndex + destIndex + blockIndex * 4 * lanes;
+				//clamp block size so we don't write past the end of dest
+				const uint32_t size = static_cast<uint32_t>(std::min<uint64_t>(blockSize, destSize - destIndex));
+				if (!decodeBlock(format, m_decodeMethod, lanes, block, size, dest + destIndex, T + item * workSize))
+				{
+					blocksDecoded = false;
+				}
 			}
-			//sum counts
-			for (uint32_t symbol = 1; symbol < 256; ++symbol)
+		});
+		return blocksDecoded ? static_cast<size_t>(destSize) : 0;
+	}
+	return 0;
+}
+
+/// @brief Incremental BWT encoder. Collects one block of input at a time and transforms it when it is complete.
+class BwtEncodeStream : public I_CodecStream
+{
+public:
+	BwtEncodeStream(uint32_t blockSize, uint32_t lanes, uint64_t sourceSize)
+		: m_blockSize(blockSize), m_lanes(lanes), m_sourceSize(sourceSize), m_indices(blockSize), m_block(lanes > 1 ? blockSize : 0)
+	{
+		m_input.reserve(blockSize);
+	}
+
+	virtual bool push(const uint8_t * data, size_t size, std::vector<uint8_t> & output) override
+	{
+		if (m_position + size > m_sourceSize)
+		{
+			return false;
+		}
+		if (m_position == 0 && size > 0)
+		{
+			//output source size, block size, format and lanes
+			std::vector<uint8_t> header(Tools::MaxSizeBytes + 5);
+			size_t headerIndex = 0;
+			Bwt::writeHeader(header.data(), headerIndex, m_sourceSize, m_blockSize, m_lanes);
+			output.insert(output.end(), header.cbegin(), std::next(header.cbegin(), headerIndex));
+		}
+		m_position += size;
+		while (size > 0)
+		{
+			//fill up current block and transform it when it is full
+			const size_t count = std::min(size, static_cast<size_t>(m_blockSize) - m_input.size());
+			m_input.insert(m_input.end(), data, data + count);
+			data += count;
+			size -= count;
+			if (m_input.size() == m_blockSize)
 			{
-				C[symbol] += C[symbol - 1];
+				encodeInput(output);
 			}
-			//shit counts right
-			for (uint32_t symbol = 255; symbol > 0; --symbol)
+		}
+		return true;
+	}
+
+	virtual bool finish(std::vector<uint8_t> & output) override
+	{
+		encodeInput(output);
+		return m_position == m_sourceSize;
+	}
+
+private:
+	void encodeInput(std::vector<uint8_t> & output)
+	{
+		if (!m_input.empty())
+		{
+			const size_t outputIndex = output.size();
+			output.resize(outputIndex + 4 * m_lanes + m_input.size());
+			Bwt::encodeBlock(m_input.data(), static_cast<uint32_t>(m_input.size()), m_lanes, &output[outputIndex], m_indices.data(), m_block.data());
+			m_input.clear();
+		}
+	}
+
+	const uint32_t m_blockSize;
+	const uint32_t m_lanes;
+	const uint64_t m_sourceSize;
+	uint64_t m_position = 0;
+	std::vector<uint8_t> m_input;
+	std::vector<int32_t> m_indices;
+	std::vector<uint8_t> m_block;
+};
+
+/// @brief Incremental BWT decoder. Collects one block of input at a time and transforms it back when it is complete.
+class BwtDecodeStream : public I_CodecStream
+{
+public:
+	BwtDecodeStream(uint32_t decodeMethod)
+		: m_decodeMethod(decodeMethod)
+	{
+	}
+
+	virtual bool push(const uint8_t * data, size_t size, std::vector<uint8_t> & output) override
+	{
+		while (size > 0)
+		{
+			m_input.push_back(*data++);
+			size--;
+			if (!m_headerRead)
 			{
-				C[symbol] = C[symbol - 1];
+				//collect header bytes until we have the size, block size, format and lanes
+				size_t index = 0;
+				if (Bwt::readHeader(m_input.data(), m_input.size(), index, m_destSize, m_blockSize, m_format, m_lanes))
+				{
+					m_T.resize(m_blockSize);
+					m_headerRead = true;
+					m_input.clear();
+				}
 			}
-			C[0] = 0;
-			//undo the BWT by reading symbol, then looking up next index through transform arrays
-			uint32_t index = startIndex;
-			for (uint32_t i = 0; i < size; ++i)
+			else
 			{
-				const uint8_t symbol = blockData[index];
-				dest[destIndex++] = symbol;
-				index = T[index] + C[symbol];
+				//collect block data and transform it back when complete
+				if (m_destIndex >= m_destSize)
+				{
+					return false;
+				}
+				const size_t blockSize = 4 * m_lanes + static_cast<size_t>(std::min<uint64_t>(m_blockSize, m_destSize - m_destIndex));
+				const size_t count = std::min(size, blockSize - m_input.size());
+				m_input.insert(m_input.end(), data, data + count);
+				data += count;
+				size -= count;
+				if (m_input.size() == blockSize && !decodeInput(output))
+				{
+					return false;
+				}
 			}
-			srcIndex += size;
 		}
-		return dest;
+		return true;
 	}
-	return std::vector<uint8_t>();
-}
\ No newline at end of file
+
+	virtual bool finish(std::vector<uint8_t> & /*output*/) override
+	{
+		//no input at all is fine, as encode() produces no output for empty data
+		if (!m_headerRead)
+		{
+			return m_input.empty();
+		}
+		return m_input.empty() && m_destIndex == m_destSize;
+	}
+
+private:
+	bool decodeInput(std::vector<uint8_t> & output)
+	{
+		const uint32_t size = static_cast<uint32_t>(m_input.size() - 4 * m_lanes);
+		const size_t outputIndex = output.size();
+		output.resize(outputIndex + size);
+		if (!Bwt::decodeBlock(m_format, m_decodeMethod, m_lanes, m_input.data(), size, &output[outputIndex], m_T.data()))
+		{
+			return false;
+		}
+		m_destIndex += size;
+		m_input.clear();
+		return true;
+	}
+
+	const uint32_t m_decodeMethod;
+	bool m_headerRead = false;
+	uint64_t m_destSize = 0;
+	uint64_t m_destIndex = 0;
+	uint32_t m_blockSize = 0;
+	Bwt::Format m_format = Bwt::Format::Sais;
+	uint32_t m_lanes = 1;
+	std::vector<uint8_t> m_input;
+	std::vector<uint32_t> m_T;
+};
+
+I_CodecStream::SPtr Bwt::createEncodeStream(uint64_t sourceSize) const
+{
+	//the source size is stored in front of the data, so we need to know it
+	if (sourceSize == 0 || m_blockSize == 0)
+	{
+		return I_Codec::createEncodeStream(sourceSize);
+	}
+	return std::make_shared<BwtEncodeStream>(m_blockSize, m_lanes, sourceSize);
+}
+
+I_CodecStream::SPtr Bwt::createDecodeStream() const
+{
+	return std::make_shared<BwtDecodeStream>(m_decodeMethod);
+}
@@ -3,6 +3,9 @@
 #include "huffman_codec.h"
 #include "delta_codec.h"
 #include "bwt_codec.h"
+#include "lz4_codec.h"
+#include "lzh_codec.h"
+#include "lz_dictionary.h"
 #include "lzss_codec.h"
 #include "mtf1_codec.h"
 #include "rgb2planes_codec.h"
@@ -14,7 +17,10 @@
 #include <chrono>
 #include <string>
 #include <iomanip>
+#include <iterator>
 #include <fstream>
+#include <sstream>
+#include <memory>
 #include <regex>
 
 #if defined(__GNUC__) || defined(__clang__)
@@ -25,12 +31,16 @@
 	namespace FS_NAMESPACE = std::tr2::sys;
 #endif
 
-enum CompressMode { None, Compress, Decompress, Test };
+enum CompressMode { None, Compress, Decompress, Test, Train };
 CompressMode m_mode = None;
 bool m_beVerbose = false;
 bool m_doBenchmark = false;
 bool m_doTest = false;
 bool m_useDirectories = false;
+uint32_t m_blockSize = Compressor::DefaultBlockSize; //size of blocks the input is split into
+uint32_t m_threadCount = 0; //number of threads to use. 0 means all hardware threads
+std::shared_ptr<const std::vector<uint8_t>> m_dictionary; //dictionary for codecs that can use one. nullptr if none is used
+size_t m_trainSize = 64 * 1024; //size of dictionary to train
 FS_NAMESPACE::path m_inputPath; //input file name.
 FS_NAMESPACE::path m_outputPath; //output file name.
 std::ofstream m_badOfStream; //we need this later as a default parameter...
@@ -87,7 +97,7 @@ std::vector<uint8_t> readFileContent(const FS_NAMESPACE::path & fileName)
 			std::cout << "File is empty!" << std::endl;
 			return std::vector<uint8_t>();
 		}
-		else if (fileSize < std::numeric_limits<int32_t>::max())
+		else if (fileSize <= std::numeric_limits<size_t>::max())
 		{
 			//try opening file
 			std::ifstream in(fileName, std::ios_base::in | std::ios_base::binary);
@@ -97,7 +107,7 @@ std::vector<uint8_t> readFileContent(const FS_NAMESPACE::path & fileName)
 				std::vector<uint8_t> result(fileSize);
 				//try reading from file
 				in.read((char*)result.data(), fileSize);
-				if (in.gcount() == fileSize)
+				if (static_cast<uint64_t>(in.gcount()) == fileSize)
 				{
 					if (m_beVerbose) std::cout << "Read " << fileSize << " bytes from file." << std::endl;
 					in.close();
@@ -126,59 +136,86 @@ std::vector<uint8_t> readFileContent(const FS_NAMESPACE::path & fileName)
 	return std::vector<uint8_t>();
 }
 
-bool writeFileContent(const FS_NAMESPACE::path & fileName, const std::vector<uint8_t> & data)
+std::shared_ptr<std::istream> openInputStream(const FS_NAMESPACE::path & fileName, uint64_t & size)
 {
-	//try opening file
-	std::ofstream out(fileName, std::ios_base::out | std::ios_base::trunc | std::ios_base::binary);
-	if (out)
+	//check if the file name is "random"
+	if (fileName.string() == "random")
+	{
+		const std::vector<uint8_t> data = generateRandomData();
+		size = data.size();
+		return std::make_shared<std::istringstream>(std::string(data.cbegin(), data.cend()));
+	}
+	std::cout << "Opening \"" << fileName << "\"" << std::endl;
+	//check if the file exists
+	if (FS_NAMESPACE::exists(fileName))
 	{
-		if (m_beVerbose) std::cout << "File " << fileName << " opened." << std::endl;
-		//try writing to file
-		out.write((char*)data.data(), data.size());
-		if (out.good())
+		//check if it isn't empty
+		size = FS_NAMESPACE::file_size(fileName);
+		if (size > 0)
 		{
-			if (m_beVerbose) std::cout << "Data written to file." << std::endl;
-			out.close();
-			return true;
+			//try opening file
+			auto in = std::make_shared<std::ifstream>(fileName, std::ios_base::in | std::ios_base::binary);
+			if (*in)
+			{
+				if (m_beVerbose) std::cout << "File " << fileName << " opened." << std::endl;
+				return in;
+			}
+			else
+			{
+				std::cout << "Failed to open " << fileName << " for reading!" << std::endl;
+			}
 		}
 		else
 		{
-			std::cout << "Error writing to file!" << std::endl;
+			std::cout << "File is empty!" << std::endl;
 		}
-		out.close();
 	}
 	else
 	{
-		std::cout << "Failed to open " << fileName << " for writing!" << std::endl;
+		std::cout << "File " << fileName << " does not exist!" << std::endl;
 	}
-	return false;
+	return nullptr;
 }
 
 //-------------------------------------------------------------------------------------------------
 
 int compress(const FS_NAMESPACE::path & input, const FS_NAMESPACE::path & output)
 {
-	//read file data
-	std::vector<uint8_t> source = readFileContent(input);
-	if (source.size() > 0)
+	//open input file. data is read block by block while compressing
+	uint64_t sourceSize = 0;
+	auto in = openInputStream(input, sourceSize);
+	if (in)
 	{
-		//try to compress input data
-		Compressor comp;
-		comp.setVerboseOutput(m_beVerbose);
-		if (m_beVerbose) std::cout << "Compressing..." << std::endl;
-		std::vector<uint8_t> result = comp.compress(source, m_codecs);
-		if (result.size() > 0)
+		//try opening output file
+		std::ofstream out(output, std::ios_base::out | std::ios_base::trunc | std::ios_base::binary);
+		if (out)
 		{
-			//worked. write to file
-			std::cout << "Data compressed to " << result.size() << " bytes (including header)." << std::endl;
-			std::cout << "Compression ratio is " << 100.0f - (float)result.size() / (float)source.size() * 100.0f << "% (" << (float)result.size() * 8 / (float)source.size() << " bpc)." << std::endl;
-			return writeFileContent(output, result) ? 0 : -3;
+			//try to compress input data
+			Compressor comp;
+			comp.setVerboseOutput(m_beVerbose);
+			comp.setBlockSize(m_blockSize);
+			comp.setThreadCount(m_threadCount);
+			comp.setDictionary(m_dictionary);
+			if (m_beVerbose) std::cout << "Compressing..." << std::endl;
+			const uint64_t resultSize = comp.compress(*in, sourceSize, out, m_codecs);
+			if (resultSize > 0)
+			{
+				//worked
+				std::cout << "Data compressed to " << resultSize << " bytes (including header)." << std::endl;
+				std::cout << "Compression ratio is " << 100.0f - (float)resultSize / (float)sourceSize * 100.0f << "% (" << (float)resultSize * 8 / (float)sourceSize << " bpc)." << std::endl;
+				return 0;
+			}
+			else
+			{
+				std::cout << "Compression failed!" << std::endl;
+			}
+			return -2;
 		}
 		else
 		{
-			std::cout << "Compression failed!" << std::endl;
+			std::cout << "Failed to open " << output << " for writing!" << std::endl;
 		}
-		return -2;
+		return -3;
 	}
 	else
 	{
@@ -189,26 +226,39 @@ int compress(const FS_NAMESPACE::path & input, const FS_NAMESPACE::path & output
 
 int decompress(const FS_NAMESPACE::path & input, const FS_NAMESPACE::path & output)
 {
-	//read file data
-	std::vector<uint8_t> source = readFileContent(input);
-	if (source.size() > 0)
+	//open input file. data is read block by block while decompressing
+	uint64_t sourceSize = 0;
+	auto in = openInputStream(input, sourceSize);
+	if (in)
 	{
-		//try to decompress input data
-		Compressor comp;
-		comp.setVerboseOutput(m_beVerbose);
-		if (m_beVerbose) std::cout << "Decompressing..." << std::endl;
-		std::vector<uint8_t> result = comp.decompress(source);
-		if (result.size() > 0)
+		//try opening output file
+		std::ofstream out(output, std::ios_base::out | std::ios_base::trunc | std::ios_base::binary);
+		if (out)
 		{
-			//worked. write to file
-			std::cout << "Data decompressed to " << result.size() << " bytes (including header)." << std::endl;
-			return writeFileContent(output, result) ? 0 : -3;
+			//try to decompress input data
+			Compressor comp;
+			comp.setVerboseOutput(m_beVerbose);
+			comp.setThreadCount(m_threadCount);
+			comp.setDictionary(m_dictionary);
+			if (m_beVerbose) std::cout << "Decompressing..." << std::endl;
+			const uint64_t resultSize = comp.decompress(*in, out);
+			if (resultSize > 0)
+			{
+				//worked
+				std::cout << "Data decompressed to " << resultSize << " bytes." << std::endl;
+				return 0;
+			}
+			else
+			{
+				std::cout << "Decompression failed!" << std::endl;
+			}
+			return -2;
 		}
 		else
 		{
-			std::cout << "Decompression failed!" << std::endl;
+			std::cout << "Failed to open " << output << " for writing!" << std::endl;
 		}
-		return -2;
+		return -3;
 	}
 	else
 	{
@@ -226,16 +276,21 @@ int test(const FS_NAMESPACE::path & input)
 		//try to compress input data
 		Compressor comp;
 		comp.setVerboseOutput(m_beVerbose);
+		comp.setBlockSize(m_blockSize);
+		comp.setThreadCount(m_threadCount);
+		comp.setDictionary(m_dictionary);
 		if (m_beVerbose) std::cout << "Compressing..." << std::endl;
 		//record start time
 		const uint32_t testCount = m_doBenchmark ? 10 : 1;
 		auto startTime = std::chrono::steady_clock::now();
-		//do compression
-		std::vector<uint8_t> compressedData;
+		//do compression. the buffer is allocated once, so benchmark runs only measure compression
+		std::vector<uint8_t> compressedData(comp.compressBound(source.size()));
+		uint64_t compressedSize = 0;
 		for (uint32_t i = 0; i < testCount; ++i)
 		{
-			compressedData = comp.compress(source, m_codecs);
+			compressedSize = comp.compress(source.data(), source.size(), compressedData.data(), compressedData.size(), m_codecs);
 		}
+		compressedData.resize(compressedSize);
 		//print compression information
 		std::cout << "Data compressed to " << compressedData.size() << " bytes (including header)." << std::endl;
 		std::cout << "Compression ratio is " << 100.0f - (float)compressedData.size() / (float)source.size() * 100.0f << "% (" << (float)compressedData.size() * 8 / (float)source.size() << " bpc)." << std::endl;
@@ -253,11 +308,13 @@ int test(const FS_NAMESPACE::path & input)
 			//record new start time
 			startTime = std::chrono::steady_clock::now();
 			//worked. try to decompress again
-			std::vector<uint8_t> decompressedData;
+			std::vector<uint8_t> decompressedData(comp.decompressedSize(compressedData.data(), compressedData.size()));
+			uint64_t decompressedSize = 0;
 			for (uint32_t i = 0; i < testCount; ++i)
 			{
-				decompressedData = comp.decompress(compressedData);
+				decompressedSize = comp.decompress(compressedData.data(), compressedData.size(), decompressedData.data(), decompressedData.size());
 			}
+			decompressedData.resize(decompressedSize);
 			//print timing information
 			if (m_doBenchmark)
 			{
@@ -298,8 +355,82 @@ int test(const FS_NAMESPACE::path & input)
 	return -1;
 }
 
+int train(const FS_NAMESPACE::path & input, const FS_NAMESPACE::path & output)
+{
+	//collect the input file, all files in the input directory or all files matching the wildcards
+	std::vector<FS_NAMESPACE::path> sampleFiles;
+	if (FS_NAMESPACE::is_regular_file(input))
+	{
+		sampleFiles.push_back(input);
+	}
+	else
+	{
+		FS_NAMESPACE::path directoryPath = input;
+		std::string fileName = input.filename();
+		std::regex fileRegEx(".*");
+		if (!FS_NAMESPACE::is_directory(input) && std::find(fileName.cbegin(), fileName.cend(), '*') != fileName.cend())
+		{
+			//build regular expression from wildcards
+			replaceAll(fileName, ".", "\\.");
+			replaceAll(fileName, "*", ".*");
+			fileRegEx = std::regex(fileName);
+			directoryPath = FS_NAMESPACE::path(input).remove_filename();
+		}
+		if (FS_NAMESPACE::is_directory(directoryPath))
+		{
+			FS_NAMESPACE::directory_iterator endIt;
+			FS_NAMESPACE::directory_iterator dirIt(directoryPath);
+			for (; dirIt != endIt; ++dirIt)
+			{
+				const std::string inFileName = dirIt->path().filename();
+				std::smatch dummyMatch;
+				if (is_regular_file(dirIt->path()) && std::regex_match(inFileName, dummyMatch, fileRegEx))
+				{
+					sampleFiles.push_back(dirIt->path());
+				}
+			}
+		}
+	}
+	//read samples. there are usually lots of small files, so this is done quietly
+	std::vector<std::vector<uint8_t>> samples;
+	size_t samplesSize = 0;
+	for (const auto & sampleFile : sampleFiles)
+	{
+		std::ifstream in(sampleFile, std::ios_base::in | std::ios_base::binary);
+		std::vector<uint8_t> sample((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+		samplesSize += sample.size();
+		samples.push_back(std::move(sample));
+	}
+	if (samplesSize == 0)
+	{
+		std::cout << "No sample data found in \"" << input << "\"!" << std::endl;
+		return -1;
+	}
+	std::cout << "Training dictionary from " << samples.size() << " sample(s) of " << samplesSize << " bytes." << std::endl;
+	const std::vector<uint8_t> dictionary = trainLZDictionary(samples, m_trainSize);
+	if (dictionary.empty())
+	{
+		std::cout << "The samples have nothing in common. Use more samples!" << std::endl;
+		return -2;
+	}
+	//write dictionary file
+	std::ofstream out(output, std::ios_base::out | std::ios_base::trunc | std::ios_base::binary);
+	if (!out || !out.write(reinterpret_cast<const char *>(dictionary.data()), dictionary.size()))
+	{
+		std::cout << "Failed to write dictionary to " << output << "!" << std::endl;
+		return -3;
+	}
+	std::cout << "Dictionary of " << dictionary.size() << " bytes written to " << output << "." << std::endl;
+	return 0;
+}
+
 int run()
 {
+	//training builds one dictionary from all input files
+	if (m_mode == CompressMode::Train)
+	{
+		return train(m_inputPath, m_outputPath);
+	}
 	//first check wether we have a directory, regular file, or wildcards
 	if (FS_NAMESPACE::is_directory(m_inputPath))
 	{
@@ -447,32 +578,59 @@ int run()
 
 void printVersion()
 {
-	std::cout << "CoMPres5 v0.6" << std::endl << std::endl;
+	std::cout << "CoMPres5 v0.7" << std::endl << std::endl;
 }
 
 void printUsage()
 {
 	std::cout << std::endl;
 	std::cout << "Usage: cmp5 [-c, -d, -t] [options] <infile> [outfile]" << std::endl;
+	std::cout << "       cmp5 train[size] <sample file, directory or wildcards> <dictfile>" << std::endl;
 	std::cout << "Available options (you must specify -c, -d or -t):" << std::endl;
 	std::cout << "-c Compress data from <infile> to <outfile>." << std::endl;
 	std::cout << "-d Decompress data from <infile> to <outfile>." << std::endl;
 	std::cout << "-t Test routines by compressing/decompressing data from <infile> in memory." << std::endl;
 	std::cout << "-b Benchmark compression and decompression." << std::endl;
 	std::cout << "-v Be verbose." << std::endl;
+	std::cout << "-block[size] Compress data in independent blocks of this size. Size is optional," << std::endl;
+	std::cout << "             e.g. \"-block1048576\" (Default is 16MB - 1Byte, min. is 4kB)." << std::endl;
+	std::cout << "-threads[count] Number of threads to use, e.g. \"-threads4\" (Default is all)." << std::endl;
+	std::cout << "                Also used by the BWT to (un-)transform blocks and LZSS for chunks in parallel." << std::endl;
+	std::cout << "-dict:<dictfile> Fill the LZSS dictionary with this file before (de-)compressing. Made for lots of small" << std::endl;
+	std::cout << "                 files sharing content. Use the same dictionary for compression and decompression." << std::endl;
+	std::cout << "train[size] Build a dictionary from sample files, e.g. \"train16384\" (Default is 64kB)." << std::endl;
 	std::cout << "Use \"random\" for <infile> to generate random input data." << std::endl;
 	std::cout << "Available pre-processing options (optional):" << std::endl;
 	std::cout << "-rgbSplit Split R8G8B8 data into color planes (size must be divisible by 3)." << std::endl;
 	std::cout << "-delta Apply delta-encoding." << std::endl;
-	std::cout << "-bwt[block size] Apply Burrows-Wheeler transform. Block size is optional," << std::endl;
+	std::cout << "-bwt[block size][:lanes] Apply Burrows-Wheeler transform. Block size is optional," << std::endl;
 	std::cout << "                 e.g. \"-bwt1024\" (Default is 65535, max. is 16MB - 1Byte)." << std::endl;
+	std::cout << "                 Add \":[lanes]\" to store start indices for decoding blocks in multiple lanes," << std::endl;
+	std::cout << "                 which is faster for big blocks, e.g. \"-bwt4194303:8\" (Default is 1, max. is 32)." << std::endl;
 	std::cout << "-mtf1 Apply move-to-front-1 encoding." << std::endl;
 	std::cout << "-rle0 Apply zero run-length encoding." << std::endl;
 	std::cout << "Available entropy coders (optional):" << std::endl;
-	std::cout << "-huffman Use static Huffman entropy coder." << std::endl;
+	std::cout << "-huffman[:streams][:block size] Use static Huffman entropy coder. The number of streams is optional. More streams" << std::endl;
+	std::cout << "             decode faster, e.g. \"-huffman:4\" (Default is 1, can be 1, 4 or 8)." << std::endl;
+	std::cout << "             Add \":[block size]\" to give every block its own codes, e.g. \"-huffman:4:65536\"" << std::endl;
+	std::cout << "             (Default is one code for all data, min. is 4kB, max. is 16MB)." << std::endl;
 	//std::cout << "-ahuffman Use adaptive Huffman entropy coder." << std::endl;
-	std::cout << "-lzss[dict size] Use LZSS entropy coder. Dictionary size is optional." << std::endl;
+	std::cout << "-lzss[dict size][:level][:chunk size] Use LZSS entropy coder. Dictionary size is optional." << std::endl;
 	std::cout << "                 e.g. \"-lzss1024\" (Default is 4096, must be a power of 2)." << std::endl;
+	std::cout << "                 Add \":[level]\" to trade speed for compression, 1 is fastest, 9 compresses best," << std::endl;
+	std::cout << "                 e.g. \"-lzss16384:9\" (Default is 6)." << std::endl;
+	std::cout << "                 Add \":[chunk size]\" to (de-)compress chunks on multiple threads, e.g. \"-lzss16384:6:1048576\"." << std::endl;
+	std::cout << "                 Append \"+\" to use the end of the previous chunk as dictionary. This compresses better," << std::endl;
+	std::cout << "                 but chunks are decompressed one after another (Default is no chunks, min. is 4kB)." << std::endl;
+	std::cout << "-lz4[:level] Use byte-aligned LZ coder that decompresses fast. Level is optional, 1 is fastest," << std::endl;
+	std::cout << "             9 compresses best, e.g. \"-lz4:9\" (Default is 1)." << std::endl;
+	std::cout << "-lzh[:level][:window size][:memory] Use LZ coder with Huffman-coded literals, lengths and distances." << std::endl;
+	std::cout << "             Level is optional, 1 is fastest, 9 compresses best, e.g. \"-lzh:9\" (Default is 6)." << std::endl;
+	std::cout << "             Add \":[window size]\" to find matches further back, e.g. \"-block67108864 -lzh:6:67108864\"" << std::endl;
+	std::cout << "             (Default is 64kB, max. is 64MB). Matches never reach into the previous block, so windows" << std::endl;
+	std::cout << "             bigger than the block size (Default is 16MB - 1Byte) need a matching \"-block\" size." << std::endl;
+	std::cout << "             Add \":[memory]\" to limit the match finder memory in bytes," << std::endl;
+	std::cout << "             e.g. \"-block67108864 -lzh:6:67108864:8388608\" (Default is 32MB, min. is 2MB)." << std::endl;
 	std::cout << "Examples:" << std::endl;
 	std::cout << "cmp5 -c -huffman ./canterbury/alice29.txt ./alice29.cmp5 (compress file)" << std::endl;
 	std::cout << "cmp5 -d ./alice29.cmp5 ./canterbury/alice29_2.txt (decompress file)" << std::endl;
@@ -480,6 +638,8 @@ void printUsage()
 	std::cout << "cmp5 -c -huffman ./canterbury ./compressed (compress files in directory)" << std::endl;
 	std::cout << "cmp5 -c -huffman ./test/*.txt (compress files matching wildcards)" << std::endl;
 	std::cout << "cmp5 -c -v -lzss random (compress random generated data and be verbose)" << std::endl;
+	std::cout << "cmp5 train ./messages ./messages.dict (build dictionary from files in directory)" << std::endl;
+	std::cout << "cmp5 -c -lzss -dict:./messages.dict ./messages ./compressed (compress small files using dictionary)" << std::endl;
 }
 bool readArguments(int argc, const char * argv[])
 {
@@ -498,6 +658,76 @@ bool readArguments(int argc, const char * argv[])
 			else if (argument == "-d") { m_mode = CompressMode::Decompress; continue; }
 			else if (argument == "-t") { m_mode = CompressMode::Test; continue; }
 			else if (argument == "-v") { m_beVerbose = true; continue; }
+			else if (i == 1 && argument.find("train") == 0)
+			{
+				m_mode = CompressMode::Train;
+				//check if the user has passed a dictionary size
+				const std::string sizeString = argument.substr(5);
+				if (!sizeString.empty())
+				{
+					//check if the string can be converted to a number
+					const uint32_t trainSize = std::stoul(sizeString);
+					if (trainSize >= 256 && trainSize <= 16 * 1024 * 1024)
+					{
+						m_trainSize = trainSize;
+					}
+					else
+					{
+						std::cout << "Error: Bad dictionary size value \"" << sizeString << "\"! Ignoring." << std::endl;
+					}
+				}
+				continue;
+			}
+			else if (argument.find("-dict:") == 0)
+			{
+				//read dictionary. it is set on the codecs and the decompressor
+				const std::vector<uint8_t> dictionary = readFileContent(argument.substr(6));
+				if (dictionary.empty())
+				{
+					std::cout << "Error: Bad dictionary file \"" << argument.substr(6) << "\"!" << std::endl;
+					return false;
+				}
+				m_dictionary = std::make_shared<const std::vector<uint8_t>>(dictionary);
+				continue;
+			}
+			else if (argument.find("-block") == 0)
+			{
+				//check if the user has passed a block size
+				const std::string blockString = argument.substr(6);
+				if (!blockString.empty())
+				{
+					//check if the string can be converted to a number
+					const uint32_t blockSize = std::stoul(blockString);
+					if (blockSize >= Compressor::MinBlockSize && blockSize <= Compressor::MaxBlockSize)
+					{
+						m_blockSize = blockSize;
+					}
+					else
+					{
+						std::cout << "Error: Bad block size value \"" << blockString << "\"! Ignoring." << std::endl;
+					}
+				}
+				continue;
+			}
+			else if (argument.find("-threads") == 0)
+			{
+				//check if the user has passed a thread count
+				const std::string countString = argument.substr(8);
+				if (!countString.empty())
+				{
+					//check if the string can be converted to a number
+					const uint32_t threadCount = std::stoul(countString);
+					if (threadCount > 0)
+					{
+						m_threadCount = threadCount;
+					}
+					else
+					{
+						std::cout << "Error: Bad thread count value \"" << countString << "\"! Ignoring." << std::endl;
+					}
+				}
+				continue;
+			}
 			else if (argument == "-rgbSplit")
 			{
 				if (m_mode == CompressMode::Compress || m_mode == CompressMode::Test)
@@ -551,21 +781,40 @@ bool readArguments(int argc, const char * argv[])
 				if (m_mode == CompressMode::Compress || m_mode == CompressMode::Test)
 				{
 					Bwt::SPtr bwtCodec(Bwt::Create());
-					//check if the user has passed a block size
-					const std::string blockString = argument.substr(4);
+					uint32_t blockSize = 256 * 1024;
+					uint32_t lanes = 1;
+					//check if the user has passed a block size and a number of lanes, separated by a colon
+					const std::string parameterString = argument.substr(4);
+					const size_t colonPos = parameterString.find(':');
+					const std::string blockString = parameterString.substr(0, colonPos);
+					const std::string lanesString = colonPos != std::string::npos ? parameterString.substr(colonPos + 1) : "";
 					if (!blockString.empty())
 					{
 						//check if the string can be converted to a number
-						const uint32_t blockSize = std::stoul(blockString);
-						if (blockSize > 0 && blockSize < 16 * 1024 * 1024 - 1)
+						const uint32_t blockSizeValue = std::stoul(blockString);
+						if (blockSizeValue > 0 && blockSizeValue < 16 * 1024 * 1024 - 1)
 						{
-							bwtCodec->setCompressionParameters(blockSize);
+							blockSize = blockSizeValue;
 						}
 						else
 						{
 							std::cout << "Error: Bad block size value \"" << blockString << "\"! Ignoring." << std::endl;
 						}
 					}
+					if (!lanesString.empty())
+					{
+						//check if the string can be converted to a number
+						const uint32_t lanesValue = std::stoul(lanesString);
+						if (lanesValue >= 1 && lanesValue <= Bwt::MaxLanes)
+						{
+							lanes = lanesValue;
+						}
+						else
+						{
+							std::cout << "Error: Bad number of lanes \"" << lanesString << "\"! Ignoring." << std::endl;
+						}
+					}
+					bwtCodec->setCompressionParameters(blockSize, 1, lanes);
 					m_codecs.push_back(bwtCodec);
 				}
 				else
@@ -574,11 +823,52 @@ bool readArguments(int argc, const char * argv[])
 				}
 				continue;
 			}
-			else if (argument == "-huffman")
+			else if (argument.find("-huffman") == 0)
 			{
 				if (m_mode == CompressMode::Compress || m_mode == CompressMode::Test)
 				{
-					m_codecs.push_back(I_Codec::SPtr(StaticHuffman::Create()));
+					StaticHuffman::SPtr huffmanCodec(StaticHuffman::Create());
+					//check if the user has passed a stream count and a block size, separated by colons
+					const std::string parameterString = argument.substr(8);
+					std::istringstream parameterStream(parameterString.empty() || parameterString[0] != ':' ? parameterString : parameterString.substr(1));
+					std::string streamString;
+					std::string blockString;
+					std::getline(parameterStream, streamString, ':');
+					std::getline(parameterStream, blockString, ':');
+					if (!parameterString.empty() && parameterString[0] != ':')
+					{
+						std::cout << "Error: Bad Huffman parameters \"" << parameterString << "\"! Ignoring." << std::endl;
+					}
+					else
+					{
+						if (!streamString.empty())
+						{
+							//check if the string can be converted to a number
+							const uint32_t streamCount = std::stoul(streamString);
+							if (streamCount == 1 || streamCount == 4 || streamCount == 8)
+							{
+								huffmanCodec->setStreamCount(streamCount);
+							}
+							else
+							{
+								std::cout << "Error: Bad stream count \"" << streamString << "\"! Ignoring." << std::endl;
+							}
+						}
+						if (!blockString.empty())
+						{
+							//check if the string can be converted to a number
+							const uint32_t blockSize = std::stoul(blockString);
+							if (blockSize >= StaticHuffman::MinBlockSize && blockSize <= StaticHuffman::MaxBlockSize)
+							{
+								huffmanCodec->setBlockSize(blockSize);
+							}
+							else
+							{
+								std::cout << "Error: Bad block size value \"" << blockString << "\"! Ignoring." << std::endl;
+							}
+						}
+					}
+					m_codecs.push_back(huffmanCodec);
 				}
 				else
 				{
@@ -591,22 +881,59 @@ bool readArguments(int argc, const char * argv[])
 				if (m_mode == CompressMode::Compress || m_mode == CompressMode::Test)
 				{
 					LZSS::SPtr lzssCodec(LZSS::Create());
-					//check if the user has passed a block size
-					const std::string blockString = argument.substr(5);
+					uint32_t dictBits = 12;
+					uint32_t level = LZSS::DefaultLevel;
+					//check if the user has passed a dictionary size, a compression level and a chunk size, separated by colons
+					std::istringstream parameterStream(argument.substr(5));
+					std::string blockString;
+					std::string levelString;
+					std::string chunkString;
+					std::getline(parameterStream, blockString, ':');
+					std::getline(parameterStream, levelString, ':');
+					std::getline(parameterStream, chunkString, ':');
 					if (!blockString.empty())
 					{
 						//check if the string can be converted to a number
 						const uint32_t dictSize = std::stoul(blockString);
-						const uint32_t dictBits = Tools::log2(dictSize);
-						if (dictBits >= 4 && dictBits <= 16)
+						const uint32_t dictSizeBits = Tools::log2(dictSize);
+						if (dictSizeBits >= 4 && dictSizeBits <= 16)
 						{
-							lzssCodec->setCompressionParameters(dictBits, dictBits / 4);
+							dictBits = dictSizeBits;
 						}
 						else
 						{
 							std::cout << "Error: Bad dictionary size value \"" << blockString << "\"! Ignoring." << std::endl;
 						}
 					}
+					if (!levelString.empty())
+					{
+						//check if the string can be converted to a number
+						const uint32_t levelValue = std::stoul(levelString);
+						if (levelValue >= LZSS::MinLevel && levelValue <= LZSS::MaxLevel)
+						{
+							level = levelValue;
+						}
+						else
+						{
+							std::cout << "Error: Bad compression level \"" << levelString << "\"! Ignoring." << std::endl;
+						}
+					}
+					if (!chunkString.empty())
+					{
+						//a trailing "+" means chunks use the end of the previous chunk as dictionary
+						const bool chunkDictionary = chunkString.back() == '+';
+						//check if the string can be converted to a number
+						const uint32_t chunkSize = std::stoul(chunkString);
+						if (chunkSize >= 4096)
+						{
+							lzssCodec->setChunkParameters(chunkSize, chunkDictionary);
+						}
+						else
+						{
+							std::cout << "Error: Bad chunk size value \"" << chunkString << "\"! Ignoring." << std::endl;
+						}
+					}
+					lzssCodec->setCompressionParameters(dictBits, dictBits / 4, level);
 					m_codecs.push_back(lzssCodec);
 				}
 				else
@@ -615,6 +942,97 @@ bool readArguments(int argc, const char * argv[])
 				}
 				continue;
 			}
+			else if (argument.find("-lz4") == 0)
+			{
+				if (m_mode == CompressMode::Compress || m_mode == CompressMode::Test)
+				{
+					LZ4::SPtr lz4Codec(LZ4::Create());
+					//check if the user has passed a compression level after a colon
+					const std::string levelString = argument.substr(4);
+					if (!levelString.empty())
+					{
+						//check if the string can be converted to a number
+						const uint32_t level = levelString.size() > 1 && levelString[0] == ':' ? std::stoul(levelString.substr(1)) : 0;
+						if (level >= LZ4::MinLevel && level <= LZ4::MaxLevel)
+						{
+							lz4Codec->setCompressionParameters(level);
+						}
+						else
+						{
+							std::cout << "Error: Bad compression level \"" << levelString << "\"! Ignoring." << std::endl;
+						}
+					}
+					m_codecs.push_back(lz4Codec);
+				}
+				else
+				{
+					std::cout << "Not compressing. Ignoring \"" << argument << "\"." << std::endl;
+				}
+				continue;
+			}
+			else if (argument.find("-lzh") == 0)
+			{
+				if (m_mode == CompressMode::Compress || m_mode == CompressMode::Test)
+				{
+					LZH::SPtr lzhCodec(LZH::Create());
+					uint32_t windowSize = LZH::MinWindowSize;
+					size_t matchFinderMemory = LZH::DefaultMatchFinderMemory;
+					//check if the user has passed a compression level, a window size and a memory limit, each after a colon
+					std::istringstream parameterStream(argument.size() > 4 && argument[4] == ':' ? argument.substr(5) : argument.substr(4));
+					std::string levelString;
+					std::string windowString;
+					std::string memoryString;
+					std::getline(parameterStream, levelString, ':');
+					std::getline(parameterStream, windowString, ':');
+					std::getline(parameterStream, memoryString, ':');
+					if (!levelString.empty())
+					{
+						//check if the string can be converted to a number
+						const uint32_t level = argument[4] == ':' ? std::stoul(levelString) : 0;
+						if (level >= LZH::MinLevel && level <= LZH::MaxLevel)
+						{
+							lzhCodec->setCompressionParameters(level);
+						}
+						else
+						{
+							std::cout << "Error: Bad compression level \"" << levelString << "\"! Ignoring." << std::endl;
+						}
+					}
+					if (!windowString.empty())
+					{
+						//check if the string can be converted to a number
+						const uint32_t windowValue = std::stoul(windowString);
+						if (windowValue >= LZH::MinWindowSize && windowValue <= LZH::MaxWindowSize)
+						{
+							windowSize = windowValue;
+						}
+						else
+						{
+							std::cout << "Error: Bad window size value \"" << windowString << "\"! Ignoring." << std::endl;
+						}
+					}
+					if (!memoryString.empty())
+					{
+						//check if the string can be converted to a number
+						const size_t memoryValue = std::stoull(memoryString);
+						if (memoryValue >= LZH::MinMatchFinderMemory)
+						{
+							matchFinderMemory = memoryValue;
+						}
+						else
+						{
+							std::cout << "Error: Bad match finder memory value \"" << memoryString << "\"! Ignoring." << std::endl;
+						}
+					}
+					lzhCodec->setWindowParameters(windowSize, matchFinderMemory);
+					m_codecs.push_back(lzhCodec);
+				}
+				else
+				{
+					std::cout << "Not compressing. Ignoring \"" << argument << "\"." << std::endl;
+				}
+				continue;
+			}
 			//none of the options was matched until here so we must be past the options
 			pastOptions = true;
 		}
@@ -622,7 +1040,7 @@ bool readArguments(int argc, const char * argv[])
 		if (pastOptions && !pastInput)
 		{
 			//do not accept random data for decompression
-			if (m_mode == CompressMode::Decompress || argument == "random")
+			if (m_mode == CompressMode::Decompress && argument == "random")
 			{
 				std::cout << "Can not use \"random\" input data for decompression!" << std::endl;
 				return false;
@@ -655,6 +1073,17 @@ bool readArguments(int argc, const char * argv[])
 					return false;
 				}
 			}
+			else if (m_mode == CompressMode::Train)
+			{
+				//the dictionary is written to a file
+				m_outputPath = argument;
+				if (FS_NAMESPACE::is_directory(m_outputPath))
+				{
+					std::cout << "<dictfile> must be a file!" << std::endl;
+					return false;
+				}
+				pastOutput = true;
+			}
 			else
 			{
 				std::cout << "Not compressing. Ignoring \"" << argument << "\"." << std::endl;
@@ -667,6 +1096,18 @@ bool readArguments(int argc, const char * argv[])
 			return false;
 		}
 	}
+	//let codecs use the same number of threads and dictionary. this is done last, so the options can be in any order
+	for (auto & codec : m_codecs)
+	{
+		codec->setThreadCount(m_threadCount);
+		codec->setDictionary(m_dictionary);
+	}
+	//training needs a file to write the dictionary to
+	if (m_mode == CompressMode::Train && m_outputPath.empty())
+	{
+		std::cout << "Error: Training needs a <dictfile>!" << std::endl;
+		return false;
+	}
 	//if we compress or decompress we need a second argument
 	if (m_mode == CompressMode::Compress || m_mode == CompressMode::Decompress)
 	{
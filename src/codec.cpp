@@ -1,7 +1,92 @@
 #include "codec.h"
 
+#include "tools.h"
+
 
 void I_Codec::setVerboseOutput(bool verbose)
 {
 	m_verbose = verbose;
 }
+
+void I_Codec::setThreadCount(uint32_t threadCount)
+{
+	m_threadCount = threadCount;
+}
+
+void I_Codec::setDictionary(std::shared_ptr<const std::vector<uint8_t>> dictionary)
+{
+	m_dictionary = dictionary;
+}
+
+uint32_t I_Codec::threadCount() const
+{
+	return m_threadCount > 0 ? m_threadCount : Tools::hardwareThreadCount();
+}
+
+std::vector<uint8_t> I_Codec::encode(const std::vector<uint8_t> & source) const
+{
+	if (!source.empty())
+	{
+		Workspace workspace;
+		std::vector<uint8_t> dest(encodeBound(source.size()));
+		dest.resize(encodeInto(source.data(), source.size(), dest.data(), dest.size(), workspace));
+		return dest;
+	}
+	return std::vector<uint8_t>();
+}
+
+std::vector<uint8_t> I_Codec::decode(const std::vector<uint8_t> & source) const
+{
+	const size_t destSize = decodedSize(source.data(), source.size());
+	if (destSize > 0)
+	{
+		Workspace workspace;
+		std::vector<uint8_t> dest(destSize);
+		dest.resize(decodeInto(source.data(), source.size(), dest.data(), dest.size(), workspace));
+		return dest;
+	}
+	return std::vector<uint8_t>();
+}
+
+/// @brief Stream that collects all input and runs it through encode() or decode() of a codec when finished.
+class BufferedCodecStream : public I_CodecStream
+{
+public:
+	BufferedCodecStream(const I_Codec & codec, bool encode)
+		: m_codec(codec), m_encode(encode)
+	{
+	}
+
+	virtual bool push(const uint8_t * data, size_t size, std::vector<uint8_t> & /*output*/) override
+	{
+		m_input.insert(m_input.end(), data, data + size);
+		return true;
+	}
+
+	virtual bool finish(std::vector<uint8_t> & output) override
+	{
+		if (m_input.empty())
+		{
+			return true;
+		}
+		const std::vector<uint8_t> result = m_encode ? m_codec.encode(m_input) : m_codec.decode(m_input);
+		m_input.clear();
+		output.insert(output.end(), result.cbegin(), result.cend());
+		return !result.empty();
+	}
+
+private:
+	const I_Codec & m_codec;
+	const bool m_encode;
+	std::vector<uint8_t> m_input;
+};
+
+I_CodecStream::SPtr I_Codec::createEncodeStream(uint64_t /*sourceSize*/) const
+{
+	return std::make_shared<BufferedCodecStream>(*this, true);
+}
+
+I_CodecStream::SPtr I_Codec::createDecodeStream() const
+{
+	return std::make_shared<BufferedCodecStream>(*this, false);
+}
\ No newline at end of file
@@ -4,9 +4,33 @@
 #include <vector>
 #include <memory>
 #include <string>
+#include "workspace.h"
+
+/// @brief Incremental encoder or decoder created by a codec. Data is pushed in chunks of any size
+/// and output is handed back as soon as it is ready. Call finish() after the last chunk to get the remaining output.
+class I_CodecStream
+{
+public:
+	/// @brief Typedef for sharing a stream.
+	typedef std::shared_ptr<I_CodecStream> SPtr;
+
+	virtual ~I_CodecStream() {}
+
+	/// @brief Process the next chunk of input data.
+	/// @param data Pointer to input data.
+	/// @param size Size of input data.
+	/// @param output Output data that is ready is appended to this.
+	/// @return Returns false if the data could not be processed, e.g. because it is corrupt.
+	virtual bool push(const uint8_t * data, size_t size, std::vector<uint8_t> & output) = 0;
+
+	/// @brief Signal the end of input data and flush all remaining output.
+	/// @param output Remaining output data is appended to this.
+	/// @return Returns false if the data could not be processed, e.g. because it was incomplete.
+	virtual bool finish(std::vector<uint8_t> & output) = 0;
+};
 
 /// @brief Abstract base class for preprocessors and compressors used in the application.
-/// You will have to implement codecIdentifier(), encode() and decode().
+/// You will have to implement codecIdentifier(), codecName(), encodeBound(), encodeInto(), decodedSize() and decodeInto().
 class I_Codec
 {
 public:
@@ -20,6 +44,15 @@ public:
 	/// @param verbose Pass true to enable verbose output during compression.
 	virtual void setVerboseOutput(bool verbose = false);
 
+	/// @brief Set the number of threads the codec may use. Codecs that can not use multiple threads ignore this.
+	/// @param threadCount Number of threads to use. Pass 0 to use all hardware threads.
+	virtual void setThreadCount(uint32_t threadCount = 1);
+
+	/// @brief Set data that is known to encoder and decoder before any input, e.g. boilerplate shared by many small messages.
+	/// Codecs that can not use a dictionary ignore it. Data encoded with a dictionary needs the same dictionary for decoding.
+	/// @param dictionary Dictionary data. Pass nullptr to use no dictionary (the default).
+	virtual void setDictionary(std::shared_ptr<const std::vector<uint8_t>> dictionary);
+
 	/// @brief Codec identifier. Make sure there are no duplicate identifiers in the software!
 	/// @return Codec identifier.
 	/// @note It makes sense to store a static value for this in the codec for registering the codec in factories etc.
@@ -28,18 +61,69 @@ public:
 	/// @brief Codec (human-readable) name.
 	/// @return Codec name.
 	virtual std::string codecName() const = 0;
-	
-	/// @brief Apply compression algorithm to source.
+
+	/// @brief Worst-case size of the data encodeInto() produces with the current settings.
+	/// @param size Size of source data.
+	/// @return Maximum number of bytes encodeInto() will write for source data of that size.
+	virtual size_t encodeBound(size_t size) const = 0;
+
+	/// @brief Apply compression algorithm to source and write the result to a caller-provided buffer.
+	/// Temporary memory is taken from workspace, so repeated calls with the same workspace do not allocate.
+	/// @param source Pointer to source data.
+	/// @param size Size of source data.
+	/// @param dest Pointer to destination buffer.
+	/// @param destSize Size of destination buffer. Must be at least encodeBound(size).
+	/// @param workspace Scratch memory reused across calls.
+	/// @return Number of bytes written to dest. 0 if encoding failed.
+	virtual size_t encodeInto(const uint8_t * source, size_t size, uint8_t * dest, size_t destSize, Workspace & workspace) const = 0;
+
+	/// @brief Size of the data decodeInto() produces, read from the compressed data.
+	/// @param source Pointer to compressed data.
+	/// @param size Size of compressed data.
+	/// @return Size of decompressed data. 0 if the size could not be determined.
+	virtual size_t decodedSize(const uint8_t * source, size_t size) const = 0;
+
+	/// @brief Apply decompression algorithm to source and write the result to a caller-provided buffer.
+	/// Temporary memory is taken from workspace, so repeated calls with the same workspace do not allocate.
+	/// @param source Pointer to compressed data.
+	/// @param size Size of compressed data.
+	/// @param dest Pointer to destination buffer.
+	/// @param destSize Size of destination buffer. Must be at least decodedSize(source, size).
+	/// @param workspace Scratch memory reused across calls.
+	/// @return Number of bytes written to dest. 0 if decoding failed.
+	virtual size_t decodeInto(const uint8_t * source, size_t size, uint8_t * dest, size_t destSize, Workspace & workspace) const = 0;
+
+	/// @brief Apply compression algorithm to source. Calls encodeInto() with a buffer of encodeBound() bytes and a temporary workspace.
 	/// @param source Source data.
-	/// @return Number of bytes written to dest.
-	virtual std::vector<uint8_t> encode(const std::vector<uint8_t> & source) const = 0;
-	
-	/// @brief Apply decompression algorithm to source.
+	/// @return Compressed data. Empty if encoding failed.
+	std::vector<uint8_t> encode(const std::vector<uint8_t> & source) const;
+
+	/// @brief Apply decompression algorithm to source. Calls decodeInto() with a buffer of decodedSize() bytes and a temporary workspace.
 	/// @param source Source data.
-	/// @return Number of bytes written to dest.
-	virtual std::vector<uint8_t> decode(const std::vector<uint8_t> & source) const = 0;
+	/// @return Decompressed data. Empty if decoding failed.
+	std::vector<uint8_t> decode(const std::vector<uint8_t> & source) const;
+
+	/// @brief Create an incremental encoder. The output of all chunks is the same as encode() would produce for all input.
+	/// The default implementation collects all input and calls encode() in finish(). Codecs override this if they can do better.
+	/// @param sourceSize Total size of input that will be pushed or 0 if unknown. Some codecs need to know it to start output early.
+	/// @return Encoder stream. It references this codec, so the codec must outlive the stream.
+	virtual I_CodecStream::SPtr createEncodeStream(uint64_t sourceSize = 0) const;
+
+	/// @brief Create an incremental decoder for data produced by encode() or an encoder stream.
+	/// The default implementation collects all input and calls decode() in finish(). Codecs override this if they can do better.
+	/// @return Decoder stream. It references this codec, so the codec must outlive the stream.
+	virtual I_CodecStream::SPtr createDecodeStream() const;
 
 protected:
+	/// @brief Number of threads the codec may use, resolving 0 to all hardware threads.
+	uint32_t threadCount() const;
+
 	/// @brief If true the routines should output more information about the (de-)compression operation.
 	bool m_verbose = false;
+
+	/// @brief Number of threads the codec may use. 0 means all hardware threads.
+	uint32_t m_threadCount = 1;
+
+	/// @brief Dictionary data known before any input. nullptr if none is set.
+	std::shared_ptr<const std::vector<uint8_t>> m_dictionary;
 };
@@ -3,6 +3,8 @@
 #include "huffman_codec.h"
 #include "delta_codec.h"
 #include "bwt_codec.h"
+#include "lz4_codec.h"
+#include "lzh_codec.h"
 #include "lzss_codec.h"
 #include "mtf1_codec.h"
 #include "rgb2planes_codec.h"
@@ -10,15 +12,28 @@
 #include "tools.h"
 
 #include <iostream>
+#include <sstream>
 #include <algorithm>
+#include <iterator>
+#include <cstring>
 
 
-const uint32_t Compressor::MagicHeader = 0x434D5035; //"CMP5" == "CoMPre5sor" data version 5
+const uint32_t Compressor::MagicHeader = 0x434D5036; //"CMP6" == "CoMPre5sor" data version 6
+const uint32_t Compressor::MagicHeaderCmp5 = 0x434D5035; //"CMP5" == "CoMPre5sor" data version 5
+const uint32_t Compressor::DefaultBlockSize = 16 * 1024 * 1024 - 1;
+const uint32_t Compressor::MinBlockSize = 4096;
+const uint32_t Compressor::MaxBlockSize = 1024 * 1024 * 1024;
+const uint32_t Compressor::HeaderSize = 4 + 8 + 4;
+const uint32_t Compressor::BlockHeaderSize = 4 + 1;
 
 const std::map<uint8_t, I_Codec::Creator> Compressor::m_codecs = {
 	std::make_pair(Bwt::CodecIdentifier, (I_Codec::Creator)Bwt::Create),
 	std::make_pair(Delta::CodecIdentifier, (I_Codec::Creator)Delta::Create),
 	std::make_pair(StaticHuffman::CodecIdentifier, (I_Codec::Creator)StaticHuffman::Create),
+	std::make_pair(StaticHuffman::CodecIdentifierInterleaved, (I_Codec::Creator)StaticHuffman::CreateInterleaved),
+	std::make_pair(StaticHuffman::CodecIdentifierBlocked, (I_Codec::Creator)StaticHuffman::CreateBlocked),
+	std::make_pair(LZ4::CodecIdentifier, (I_Codec::Creator)LZ4::Create),
+	std::make_pair(LZH::CodecIdentifier, (I_Codec::Creator)LZH::Create),
 	std::make_pair(LZSS::CodecIdentifier, (I_Codec::Creator)LZSS::Create),
 	std::make_pair(Mtf1::CodecIdentifier, (I_Codec::Creator)Mtf1::Create),
 	std::make_pair(RgbToPlanes::CodecIdentifier, (I_Codec::Creator)RgbToPlanes::Create),
@@ -29,40 +44,264 @@ void Compressor::setVerboseOutput(bool verbose)
 	m_verbose = verbose;
 }
 
-std::vector<uint8_t> Compressor::compress(const std::vector<uint8_t> source, std::vector<I_Codec::SPtr> codecs) const
+void Compressor::setBlockSize(uint32_t blockSize)
 {
-	//build header with magic number, uncompressed size and codecs
-	std::vector<uint8_t> result(8 + 1 + codecs.size());
+	//clamp to [4096, 1GB]
+	m_blockSize = blockSize < MinBlockSize ? MinBlockSize : (blockSize > MaxBlockSize ? MaxBlockSize : blockSize);
+}
+
+uint64_t Compressor::maxIntermediateSize(uint32_t blockSize)
+{
+	//codecs expand their input by at most half its size plus their headers. 64kB covers the headers of small blocks
+	return 2 * static_cast<uint64_t>(blockSize) + 64 * 1024;
+}
+
+void Compressor::setThreadCount(uint32_t threadCount)
+{
+	m_threadCount = threadCount;
+}
+
+void Compressor::setDictionary(std::shared_ptr<const std::vector<uint8_t>> dictionary)
+{
+	m_dictionary = dictionary;
+}
+
+uint32_t Compressor::threadCount() const
+{
+	return m_threadCount > 0 ? m_threadCount : Tools::hardwareThreadCount();
+}
+
+void Compressor::prepareWorkspaces(uint32_t count) const
+{
+	if (m_workspaces.size() < count)
+	{
+		m_workspaces.resize(count);
+	}
+}
+
+void Compressor::writeHeader(uint8_t * dest, uint64_t uncompressedSize) const
+{
+	//build header with magic number, uncompressed size and block size
 	uint32_t destIndex = 0;
-	*((uint32_t *)&result[destIndex]) = MagicHeader;
+	*((uint32_t *)&dest[destIndex]) = MagicHeader;
 	destIndex += 4;
-	*((uint32_t *)&result[destIndex]) = static_cast<uint32_t>(source.size());
+	*((uint64_t *)&dest[destIndex]) = uncompressedSize;
+	destIndex += 8;
+	*((uint32_t *)&dest[destIndex]) = m_blockSize;
+}
+
+uint32_t Compressor::compressBlock(const uint8_t * source, uint32_t size, const std::vector<I_Codec::SPtr> & codecs, uint8_t * dest, BlockWorkspace & workspace) const
+{
+	//apply all encodings, alternating between two buffers. the first codec reads directly from source
+	const uint8_t * data = source;
+	size_t dataSize = size;
+	bool encoded = true;
+	for (size_t i = 0; i < codecs.size(); ++i)
+	{
+		const I_Codec::SPtr & codec = codecs[i];
+		if (m_verbose)
+		{
+			std::ostringstream message;
+			message << codec->codecName() << " input data checksum is 0x" << std::hex << Tools::calculateAdler32(data, dataSize) << std::dec << std::endl;
+			std::cout << message.str();
+		}
+		std::vector<uint8_t> & buffer = workspace.buffers[i % 2];
+		const size_t bufferSize = codec->encodeBound(dataSize);
+		if (buffer.size() < bufferSize)
+		{
+			buffer.resize(bufferSize);
+		}
+		dataSize = codec->encodeInto(data, dataSize, buffer.data(), bufferSize, workspace.codecWorkspace);
+		data = buffer.data();
+		//the decoder rejects intermediate data that is too big, so store the block uncompressed instead
+		if (dataSize == 0 || dataSize > maxIntermediateSize(size))
+		{
+			encoded = false;
+			break;
+		}
+	}
+	//store block uncompressed if the codecs failed or did not reduce the size
+	const bool useCodecs = encoded && !codecs.empty() && dataSize + codecs.size() <= size;
+	if (m_verbose && !useCodecs && !codecs.empty()) { std::cout << "Storing block uncompressed.\n"; }
+	const uint8_t nrOfCodecs = useCodecs ? static_cast<uint8_t>(codecs.size()) : 0;
+	if (!useCodecs)
+	{
+		data = source;
+		dataSize = size;
+	}
+	//write block header with compressed size and codecs
+	uint32_t destIndex = 0;
+	*((uint32_t *)&dest[destIndex]) = static_cast<uint32_t>(dataSize);
 	destIndex += 4;
-	//write codec count to data
-	result[destIndex++] = static_cast<uint8_t>(codecs.size());
-	//write codec identifiers to data
-	for (const auto & codec : codecs)
+	dest[destIndex++] = nrOfCodecs;
+	for (uint32_t i = 0; i < nrOfCodecs; ++i)
 	{
-		result[destIndex++] = codec->codecIdentifier();
+		dest[destIndex++] = codecs[i]->codecIdentifier();
+	}
+	std::copy(data, data + dataSize, dest + destIndex);
+	return destIndex + static_cast<uint32_t>(dataSize);
+}
+
+uint64_t Compressor::compressBound(uint64_t sourceSize) const
+{
+	const uint64_t nrOfBlocks = (sourceSize + m_blockSize - 1) / m_blockSize;
+	return HeaderSize + nrOfBlocks * BlockHeaderSize + sourceSize;
+}
+
+uint64_t Compressor::compress(const uint8_t * source, uint64_t size, uint8_t * dest, uint64_t destSize, const std::vector<I_Codec::SPtr> & codecs) const
+{
+	if (size == 0 || destSize < compressBound(size))
+	{
+		return 0;
 	}
-	//apply all encodings
-	std::vector<uint8_t> compressed = source;
 	for (const auto & codec : codecs)
 	{
-		if (m_verbose) { std::cout << codec->codecName() << " input data checksum is 0x" << std::hex << Tools::calculateAdler32(compressed) << std::dec << std::endl; }
 		codec->setVerboseOutput(m_verbose);
-		compressed = codec->encode(compressed);
 	}
-	//combine compressed data and header to result
-	result.resize(result.size() + compressed.size());
-	std::copy(compressed.cbegin(), compressed.cend(), std::next(result.begin(), destIndex));
+	writeHeader(dest, size);
+	uint64_t destIndex = HeaderSize;
+	//compress as many blocks at a time as we have threads. every block of a batch is written to its worst-case 
+	//position following the data already written, then the blocks are moved together. the first block never moves
+	const uint64_t nrOfBlocks = (size + m_blockSize - 1) / m_blockSize;
+	const uint32_t batchSize = static_cast<uint32_t>(std::min<uint64_t>(threadCount(), nrOfBlocks));
+	const uint64_t slotSize = BlockHeaderSize + static_cast<uint64_t>(m_blockSize);
+	if (m_verbose) { std::cout << "Compressing " << nrOfBlocks << " block(s) using " << batchSize << " thread(s)." << std::endl; }
+	std::vector<uint32_t> blockSizes(batchSize);
+	prepareWorkspaces(batchSize);
+	for (uint64_t blockIndex = 0; blockIndex < nrOfBlocks; blockIndex += batchSize)
+	{
+		const uint32_t nrOfBatchBlocks = static_cast<uint32_t>(std::min<uint64_t>(batchSize, nrOfBlocks - blockIndex));
+		const uint64_t batchStart = destIndex;
+		Tools::parallelFor(nrOfBatchBlocks, batchSize, [&](uint32_t i, uint32_t threadIndex)
+		{
+			const uint64_t blockStart = (blockIndex + i) * m_blockSize;
+			const uint32_t blockSize = static_cast<uint32_t>(std::min<uint64_t>(m_blockSize, size - blockStart));
+			blockSizes[i] = compressBlock(source + blockStart, blockSize, codecs, dest + batchStart + i * slotSize, m_workspaces[threadIndex]);
+		});
+		for (uint32_t i = 0; i < nrOfBatchBlocks; ++i)
+		{
+			if (i > 0)
+			{
+				std::memmove(dest + destIndex, dest + batchStart + i * slotSize, blockSizes[i]);
+			}
+			destIndex += blockSizes[i];
+		}
+	}
+	return destIndex;
+}
+
+std::vector<uint8_t> Compressor::compress(const std::vector<uint8_t> & source, const std::vector<I_Codec::SPtr> & codecs) const
+{
+	if (source.empty())
+	{
+		return std::vector<uint8_t>();
+	}
+	std::vector<uint8_t> result(static_cast<size_t>(compressBound(source.size())));
+	result.resize(static_cast<size_t>(compress(source.data(), source.size(), result.data(), result.size(), codecs)));
 	return result;
 }
 
-std::vector<uint8_t> Compressor::decompress(const std::vector<uint8_t> source) const
+bool Compressor::decompressBlock(const uint8_t * source, uint32_t size, const std::vector<uint8_t> & codecs, uint8_t * dest, uint32_t destSize, BlockWorkspace & workspace) const
+{
+	//a block without codecs is stored uncompressed
+	if (codecs.empty())
+	{
+		if (size != destSize)
+		{
+			std::cout << "Uncompressed block size does not match!\n";
+			return false;
+		}
+		std::copy(source, source + size, dest);
+		return true;
+	}
+	//apply codecs in reverse order, alternating between two buffers. the first codec reads directly from source
+	//and the last one writes directly to dest
+	const uint8_t * data = source;
+	size_t dataSize = size;
+	for (size_t i = 0; i < codecs.size(); ++i)
+	{
+		const uint8_t codecIdentifier = codecs[codecs.size() - 1 - i];
+		//try to find codec in list
+		if (m_codecs.find(codecIdentifier) != m_codecs.cend())
+		{
+			//create decoder once and keep it for the next blocks
+			I_Codec::SPtr & codec = workspace.decoders[codecIdentifier];
+			if (!codec)
+			{
+				codec.reset(m_codecs.at(codecIdentifier)());
+			}
+			codec->setThreadCount(m_threadCount);
+			codec->setVerboseOutput(m_verbose);
+			codec->setDictionary(m_dictionary);
+			const bool lastCodec = i == codecs.size() - 1;
+			const size_t decodedSize = codec->decodedSize(data, dataSize);
+			if (lastCodec && decodedSize != destSize)
+			{
+				std::cout << "Uncompressed block size does not match!\n";
+				return false;
+			}
+			//the size comes from the data, so check it before allocating memory
+			if (!lastCodec && decodedSize > maxIntermediateSize(destSize))
+			{
+				std::ostringstream message;
+				message << codec->codecName() << " decoded size is too big!" << std::endl;
+				std::cout << message.str();
+				return false;
+			}
+			std::vector<uint8_t> & buffer = workspace.buffers[i % 2];
+			if (!lastCodec && buffer.size() < decodedSize)
+			{
+				buffer.resize(decodedSize);
+			}
+			uint8_t * output = lastCodec ? dest : buffer.data();
+			dataSize = decodedSize > 0 ? codec->decodeInto(data, dataSize, output, decodedSize, workspace.codecWorkspace) : 0;
+			data = output;
+			if (dataSize == 0)
+			{
+				std::ostringstream message;
+				message << codec->codecName() << " failed to decode data!" << std::endl;
+				std::cout << message.str();
+				return false;
+			}
+			if (m_verbose)
+			{
+				std::ostringstream message;
+				message << codec->codecName() << " output data checksum is 0x" << std::hex << Tools::calculateAdler32(data, dataSize) << std::dec << std::endl;
+				std::cout << message.str();
+			}
+		}
+		else
+		{
+			std::ostringstream message;
+			message << "Unknown codec #" << static_cast<uint32_t>(codecIdentifier) << "!" << std::endl;
+			std::cout << message.str();
+			return false;
+		}
+	}
+	return true;
+}
+
+uint64_t Compressor::decompressedSize(const uint8_t * source, uint64_t size) const
+{
+	//check minimum size and magic header
+	if (size > 8 && source[3] == 'C' && source[2] == 'M' && source[1] == 'P')
+	{
+		if (source[0] == '5')
+		{
+			return *((uint32_t *)&source[4]);
+		}
+		else if (source[0] == '6' && size >= HeaderSize)
+		{
+			return *((uint64_t *)&source[4]);
+		}
+	}
+	return 0;
+}
+
+uint64_t Compressor::decompress(const uint8_t * source, uint64_t size, uint8_t * dest, uint64_t destSize) const
 {
 	//check minimum size
-	if (source.size() > 8)
+	if (size > 8)
 	{
 		//ok. check for magic header
 		if (source[3] == 'C' && source[2] == 'M' && source[1] == 'P')
@@ -70,64 +309,70 @@ std::vector<uint8_t> Compressor::decompress(const std::vector<uint8_t> source) c
 			//ok. check version
 			if (source[0] == '5')
 			{
-				//ok. read uncompressed size from data
-				const uint32_t uncompressedSize = *((uint32_t *)&source[4]);
-				if (uncompressedSize > 0)
+				return decompressCmp5(source, size, dest, destSize);
+			}
+			else if (source[0] == '6' && size >= HeaderSize)
+			{
+				//ok. read uncompressed size and block size from data
+				const uint64_t uncompressedSize = *((uint64_t *)&source[4]);
+				const uint32_t blockSize = *((uint32_t *)&source[12]);
+				if (uncompressedSize > 0 && blockSize > 0 && blockSize <= MaxBlockSize && uncompressedSize <= destSize)
 				{
-					//ok. get codec count from header
-					const uint8_t nrOfCodecs = source[8];
-					if (nrOfCodecs > 0)
+					//find the start of all blocks and check that the data is complete
+					struct BlockInfo
 					{
-						//source is encoded. get codecs from header
-						std::vector<uint8_t> codecs(nrOfCodecs);
-						for (int i = 0; i < nrOfCodecs; ++i)
+						uint64_t srcIndex; /// @brief Start of compressed block data.
+						uint32_t size; /// @brief Size of compressed block data.
+						std::vector<uint8_t> codecs; /// @brief Codec identifiers in encoding order.
+					};
+					const uint64_t nrOfBlocks = (uncompressedSize + blockSize - 1) / blockSize;
+					std::vector<BlockInfo> blocks;
+					uint64_t srcIndex = HeaderSize;
+					while (blocks.size() < nrOfBlocks && srcIndex + BlockHeaderSize <= size)
+					{
+						BlockInfo block;
+						block.size = *((uint32_t *)&source[srcIndex]);
+						srcIndex += 4;
+						const uint8_t nrOfCodecs = source[srcIndex++];
+						//blocks that do not shrink are stored uncompressed, so valid blocks are never bigger than the block size
+						const uint64_t blockStart = static_cast<uint64_t>(blocks.size()) * blockSize;
+						if (block.size > std::min<uint64_t>(blockSize, uncompressedSize - blockStart) || srcIndex + nrOfCodecs + block.size > size)
 						{
-							codecs[i] = source[9 + i];
+							break;
 						}
-						std::reverse(codecs.begin(), codecs.end());
-						//copy compressed data for processing
-						std::vector<uint8_t> result(source.size() - 8 - 1 - nrOfCodecs);
-						std::copy(std::next(source.cbegin(), 8 + 1 + nrOfCodecs), source.cend(), result.begin());
-						//apply codecs
-						for (int i = 0; i < nrOfCodecs; ++i)
+						block.codecs.assign(source + srcIndex, source + srcIndex + nrOfCodecs);
+						srcIndex += nrOfCodecs;
+						block.srcIndex = srcIndex;
+						srcIndex += block.size;
+						blocks.push_back(block);
+					}
+					if (blocks.size() == nrOfBlocks && srcIndex == size)
+					{
+						//decompress blocks in parallel, directly to their position in the result
+						std::vector<uint8_t> blockDecoded(blocks.size(), 0);
+						const uint32_t nrOfThreads = static_cast<uint32_t>(std::min<uint64_t>(threadCount(), blocks.size()));
+						prepareWorkspaces(nrOfThreads);
+						Tools::parallelFor(static_cast<uint32_t>(blocks.size()), nrOfThreads, [&](uint32_t blockIndex, uint32_t threadIndex)
 						{
-							//try to find codec in list
-							if (m_codecs.find(codecs[i]) != m_codecs.cend())
-							{
-								I_Codec::SPtr codec(m_codecs.at(codecs[i])());
-								codec->setVerboseOutput(m_verbose);
-								result = codec->decode(result);
-								if (m_verbose) { std::cout << codec->codecName() << " output data checksum is 0x" << std::hex << Tools::calculateAdler32(result) << std::dec << std::endl; }
-							}
-							else
-							{
-								std::cout << "Unknown codec #" << codecs[i] << "!" << std::endl;
-								std::cout << "Decompression failed!" << std::endl;
-								return std::vector<uint8_t>();
-							}
-						}
-						//check if data size matches
-						if (result.size() == uncompressedSize)
+							const BlockInfo & block = blocks[blockIndex];
+							const uint64_t destStart = static_cast<uint64_t>(blockIndex) * blockSize;
+							const uint32_t blockDestSize = static_cast<uint32_t>(std::min<uint64_t>(blockSize, uncompressedSize - destStart));
+							blockDecoded[blockIndex] = decompressBlock(source + block.srcIndex, block.size, block.codecs, dest + destStart, blockDestSize, m_workspaces[threadIndex]) ? 1 : 0;
+						});
+						if (std::find(blockDecoded.cbegin(), blockDecoded.cend(), 0) == blockDecoded.cend())
 						{
 							std::cout << "Decompression succeeded." << std::endl;
-							return result;
-						}
-						else
-						{
-							std::cout << "Uncompressed data size does not match!" << std::endl;
+							return uncompressedSize;
 						}
 					}
 					else
 					{
-						//copy compressed data for processing
-						std::vector<uint8_t> result(source.size() - 8 - 1);
-						std::copy(std::next(source.cbegin(), 8 + 1), source.cend(), result.begin());
-						return result;
+						std::cout << "Compressed data size does not match!" << std::endl;
 					}
 				}
 				else
 				{
-					std::cout << "Invalid uncompressed size of 0!" << std::endl;
+					std::cout << "Invalid uncompressed size or block size!" << std::endl;
 				}
 			}
 			else
@@ -145,5 +390,210 @@ std::vector<uint8_t> Compressor::decompress(const std::vector<uint8_t> source) c
 		std::cout << "Source data size too small!" << std::endl;
 	}
 	std::cout << "Decompression failed!" << std::endl;
-	return std::vector<uint8_t>();
+	return 0;
 }
+
+std::vector<uint8_t> Compressor::decompress(const std::vector<uint8_t> & source) const
+{
+	std::vector<uint8_t> result(static_cast<size_t>(decompressedSize(source.data(), source.size())));
+	result.resize(static_cast<size_t>(decompress(source.data(), source.size(), result.data(), result.size())));
+	return result;
+}
+
+uint64_t Compressor::decompressCmp5(const uint8_t * source, uint64_t size, uint8_t * dest, uint64_t destSize) const
+{
+	//read uncompressed size from data
+	const uint32_t uncompressedSize = *((uint32_t *)&source[4]);
+	if (uncompressedSize > 0 && uncompressedSize <= destSize)
+	{
+		//get codecs from header
+		const uint8_t nrOfCodecs = source[8];
+		if (size >= 9u + nrOfCodecs)
+		{
+			std::vector<uint8_t> codecs(source + 9, source + 9 + nrOfCodecs);
+			//all data is stored as a single block
+			const uint32_t srcIndex = 9 + nrOfCodecs;
+			prepareWorkspaces(1);
+			if (decompressBlock(source + srcIndex, static_cast<uint32_t>(size - srcIndex), codecs, dest, uncompressedSize, m_workspaces[0]))
+			{
+				std::cout << "Decompression succeeded." << std::endl;
+				return uncompressedSize;
+			}
+		}
+		else
+		{
+			std::cout << "Source data size too small!" << std::endl;
+		}
+	}
+	else
+	{
+		std::cout << "Invalid uncompressed size of 0!" << std::endl;
+	}
+	std::cout << "Decompression failed!" << std::endl;
+	return 0;
+}
+
+uint64_t Compressor::compress(std::istream & source, uint64_t sourceSize, std::ostream & dest, const std::vector<I_Codec::SPtr> & codecs) const
+{
+	if (sourceSize == 0)
+	{
+		return 0;
+	}
+	for (const auto & codec : codecs)
+	{
+		codec->setVerboseOutput(m_verbose);
+	}
+	//write header
+	std::vector<uint8_t> header(HeaderSize);
+	writeHeader(header.data(), sourceSize);
+	dest.write((const char *)header.data(), header.size());
+	uint64_t destSize = header.size();
+	//read, compress and write as many blocks at a time as we have threads
+	const uint64_t nrOfBlocks = (sourceSize + m_blockSize - 1) / m_blockSize;
+	const uint32_t batchSize = static_cast<uint32_t>(std::min<uint64_t>(threadCount(), nrOfBlocks));
+	if (m_verbose) { std::cout << "Compressing " << nrOfBlocks << " block(s) using " << batchSize << " thread(s)." << std::endl; }
+	std::vector<std::vector<uint8_t>> input(batchSize);
+	std::vector<std::vector<uint8_t>> output(batchSize, std::vector<uint8_t>(BlockHeaderSize + static_cast<size_t>(std::min<uint64_t>(m_blockSize, sourceSize))));
+	std::vector<uint32_t> outputSizes(batchSize);
+	prepareWorkspaces(batchSize);
+	for (uint64_t blockIndex = 0; blockIndex < nrOfBlocks && dest.good(); blockIndex += batchSize)
+	{
+		const uint32_t nrOfBatchBlocks = static_cast<uint32_t>(std::min<uint64_t>(batchSize, nrOfBlocks - blockIndex));
+		for (uint32_t i = 0; i < nrOfBatchBlocks; ++i)
+		{
+			const uint64_t blockStart = (blockIndex + i) * m_blockSize;
+			input[i].resize(static_cast<size_t>(std::min<uint64_t>(m_blockSize, sourceSize - blockStart)));
+			source.read((char *)input[i].data(), input[i].size());
+			if (source.gcount() != static_cast<std::streamsize>(input[i].size()))
+			{
+				std::cout << "Error reading source data!" << std::endl;
+				return 0;
+			}
+		}
+		Tools::parallelFor(nrOfBatchBlocks, batchSize, [&](uint32_t i, uint32_t threadIndex)
+		{
+			outputSizes[i] = compressBlock(input[i].data(), static_cast<uint32_t>(input[i].size()), codecs, output[i].data(), m_workspaces[threadIndex]);
+		});
+		for (uint32_t i = 0; i < nrOfBatchBlocks; ++i)
+		{
+			dest.write((const char *)output[i].data(), outputSizes[i]);
+			destSize += outputSizes[i];
+		}
+	}
+	if (!dest.good())
+	{
+		std::cout << "Error writing compressed data!" << std::endl;
+		return 0;
+	}
+	return destSize;
+}
+
+uint64_t Compressor::decompress(std::istream & source, std::ostream & dest) const
+{
+	//read magic header
+	std::vector<uint8_t> header(HeaderSize);
+	source.read((char *)header.data(), 4);
+	if (source.gcount() == 4 && header[3] == 'C' && header[2] == 'M' && header[1] == 'P')
+	{
+		if (header[0] == '5')
+		{
+			//old data is a single block. read it all
+			std::vector<uint8_t> data(header.cbegin(), std::next(header.cbegin(), 4));
+			data.insert(data.end(), std::istreambuf_iterator<char>(source), std::istreambuf_iterator<char>());
+			const std::vector<uint8_t> result = decompress(data);
+			dest.write((const char *)result.data(), result.size());
+			return dest.good() ? result.size() : 0;
+		}
+		else if (header[0] == '6')
+		{
+			//read uncompressed size and block size from data
+			source.read((char *)header.data() + 4, HeaderSize - 4);
+			const uint64_t uncompressedSize = *((uint64_t *)&header[4]);
+			const uint32_t blockSize = *((uint32_t *)&header[12]);
+			if (source.gcount() == HeaderSize - 4 && uncompressedSize > 0 && blockSize > 0 && blockSize <= MaxBlockSize)
+			{
+				//read, decompress and write as many blocks at a time as we have threads
+				const uint64_t nrOfBlocks = (uncompressedSize + blockSize - 1) / blockSize;
+				const uint32_t batchSize = static_cast<uint32_t>(std::min<uint64_t>(threadCount(), nrOfBlocks));
+				std::vector<std::vector<uint8_t>> codecs(batchSize);
+				std::vector<std::vector<uint8_t>> input(batchSize);
+				std::vector<std::vector<uint8_t>> output(batchSize);
+				std::vector<uint8_t> blockDecoded(batchSize);
+				prepareWorkspaces(batchSize);
+				for (uint64_t blockIndex = 0; blockIndex < nrOfBlocks; blockIndex += batchSize)
+				{
+					const uint32_t nrOfBatchBlocks = static_cast<uint32_t>(std::min<uint64_t>(batchSize, nrOfBlocks - blockIndex));
+					for (uint32_t i = 0; i < nrOfBatchBlocks; ++i)
+					{
+						//read block header and check the sizes before allocating memory. blocks that do not shrink
+						//are stored uncompressed, so valid blocks are never bigger than the block size
+						const uint64_t blockStart = (blockIndex + i) * blockSize;
+						const uint32_t blockDestSize = static_cast<uint32_t>(std::min<uint64_t>(blockSize, uncompressedSize - blockStart));
+						uint8_t blockHeader[BlockHeaderSize];
+						source.read((char *)blockHeader, BlockHeaderSize);
+						const uint32_t blockSrcSize = *((uint32_t *)&blockHeader[0]);
+						if (!source.good() || blockSrcSize > blockDestSize)
+						{
+							std::cout << "Compressed data size does not match!" << std::endl;
+							std::cout << "Decompression failed!" << std::endl;
+							return 0;
+						}
+						//read codecs and compressed data
+						codecs[i].resize(blockHeader[4]);
+						source.read((char *)codecs[i].data(), codecs[i].size());
+						input[i].resize(blockSrcSize);
+						source.read((char *)input[i].data(), input[i].size());
+						if (!source.good())
+						{
+							std::cout << "Compressed data size does not match!" << std::endl;
+							std::cout << "Decompression failed!" << std::endl;
+							return 0;
+						}
+						output[i].resize(blockDestSize);
+					}
+					Tools::parallelFor(nrOfBatchBlocks, batchSize, [&](uint32_t i, uint32_t threadIndex)
+					{
+						blockDecoded[i] = decompressBlock(input[i].data(), static_cast<uint32_t>(input[i].size()), codecs[i], output[i].data(), static_cast<uint32_t>(output[i].size()), m_workspaces[threadIndex]) ? 1 : 0;
+					});
+					for (uint32_t i = 0; i < nrOfBatchBlocks; ++i)
+					{
+						if (blockDecoded[i] == 0)
+						{
+							std::cout << "Decompression failed!" << std::endl;
+							return 0;
+						}
+						dest.write((const char *)output[i].data(), output[i].size());
+					}
+				}
+				//like in memory, there must be no data behind the last block
+				if (source.peek() != std::char_traits<char>::eof())
+				{
+					std::cout << "Compressed data size does not match!" << std::endl;
+				}
+				else if (dest.good())
+				{
+					std::cout << "Decompression succeeded." << std::endl;
+					return uncompressedSize;
+				}
+				else
+				{
+					std::cout << "Error writing decompressed data!" << std::endl;
+				}
+			}
+			else
+			{
+				std::cout << "Invalid uncompressed size or block size!" << std::endl;
+			}
+		}
+		else
+		{
+			std::cout << "Unknown version number found!" << std::endl;
+		}
+	}
+	else
+	{
+		std::cout << "Bad header found!" << std::endl;
+	}
+	std::cout << "Decompression failed!" << std::endl;
+	return 0;
+}
\ No newline at end of file
@@ -5,35 +5,198 @@
 #include <inttypes.h>
 #include <vector>
 #include <map>
+#include <iostream>
 
 
+/// @brief Block-framed compressor. The input is split into blocks of the same size (the last one may be shorter)
+/// and every block is run through the codecs independently, so blocks can be (de-)compressed on multiple threads.
+// Compressed data layout:
+// 00h                     | uint32_t | Magic header "CMP6".
+// 04h                     | uint64_t | Size of uncompressed data.
+// 0Ch                     | uint32_t | Size of uncompressed blocks. Only the last block may be smaller.
+// 10h                     | blocks   | Compressed blocks.
+// Compressed block layout:
+// 00h                     | uint32_t | Size of compressed block data following the codec identifiers.
+// 04h                     | uint8_t  | Number of codecs N used for the block. 0 means the block is stored uncompressed.
+// 05h                     | uint8_t  | N codec identifiers in the order they were applied when encoding.
+// 05h + N                 | bytes    | Compressed block data.
+/// @note A compressor keeps per-thread memory between calls, so steady-state (de-)compression does not allocate memory
+/// for codecs. Use one compressor per thread if you (de-)compress from multiple threads at the same time.
 class Compressor
 {
 public:
-	/// @brief Magic header "CMP5" == "CoMPre5sor" for compressed data. May be increased in future versions (ala "CMP6") for compatibility.
+	/// @brief Magic header "CMP6" == "CoMPre5sor" for block-framed compressed data. May be increased in future versions (ala "CMP7") for compatibility.
 	static const uint32_t MagicHeader;
 
+	/// @brief Magic header "CMP5" for old single-block compressed data. Can still be decompressed.
+	static const uint32_t MagicHeaderCmp5;
+
+	/// @brief Default uncompressed block size. This fits the largest BWT block and is divisible by 3 for RGB data.
+	static const uint32_t DefaultBlockSize;
+
+	/// @brief Smallest uncompressed block size.
+	static const uint32_t MinBlockSize;
+	/// @brief Biggest uncompressed block size. Data with bigger blocks is rejected when decompressing.
+	static const uint32_t MaxBlockSize;
+
 	/// @brief Toggle verbose output for operations.
 	/// @param verbose Pass true to enable verbose output during compression.
 	virtual void setVerboseOutput(bool verbose = false);
 
+	/// @brief Set the size of the blocks the input is split into for compression.
+	/// @param blockSize Uncompressed block size in bytes [MinBlockSize, MaxBlockSize]. Bigger blocks usually compress better,
+	/// smaller blocks can be spread over more threads. Use a size divisible by 3 for RGB data.
+	void setBlockSize(uint32_t blockSize = DefaultBlockSize);
+
+	/// @brief Set the number of threads used for compression and decompression.
+	/// @param threadCount Number of threads to use. Pass 0 to use all hardware threads (the default).
+	void setThreadCount(uint32_t threadCount = 0);
+
+	/// @brief Set the dictionary handed to the decoders for decompression (see I_Codec::setDictionary()).
+	/// For compression, set the dictionary on the codecs passed to compress().
+	/// @param dictionary Dictionary data. Pass nullptr to use no dictionary (the default).
+	void setDictionary(std::shared_ptr<const std::vector<uint8_t>> dictionary);
+
+	/// @brief Worst-case size of compressed data. Blocks that the codecs can not reduce in size are stored uncompressed,
+	/// so this does not depend on the codecs used.
+	/// @param sourceSize Size of source data.
+	/// @return Maximum number of bytes compress() will write for source data of that size.
+	uint64_t compressBound(uint64_t sourceSize) const;
+
+	/// @brief Compress source data into a caller-provided buffer. Codecs read their input directly from source
+	/// and work in two buffers per block, so no copies of the source data are made.
+	/// @param source Pointer to source data.
+	/// @param size Size of source data.
+	/// @param dest Pointer to destination buffer.
+	/// @param destSize Size of destination buffer. Must be at least compressBound(size).
+	/// @param codecs List of pre-configured codecs to use for compression, in this particular order.
+	/// @return Number of bytes written to dest. 0 if compression failed.
+	/// @note The codecs are shared between threads, so their encode functions must not modify them.
+	uint64_t compress(const uint8_t * source, uint64_t size, uint8_t * dest, uint64_t destSize, const std::vector<I_Codec::SPtr> & codecs) const;
+
 	/// @brief Compress source data and return result.
 	/// @param source Source data.
 	/// @param codecs List of pre-configured codecs to use for compression, in this particular order.
 	/// @return Compressed data. Empty if compression failed.
-	std::vector<uint8_t> compress(const std::vector<uint8_t> source, std::vector<I_Codec::SPtr> codecs) const;
+	/// @note The codecs are shared between threads, so their encode functions must not modify them.
+	std::vector<uint8_t> compress(const std::vector<uint8_t> & source, const std::vector<I_Codec::SPtr> & codecs) const;
+
+	/// @brief Size of decompressed data read from the header of compressed data.
+	/// @param source Pointer to compressed data.
+	/// @param size Size of compressed data.
+	/// @return Size of decompressed data. 0 if the header is invalid.
+	uint64_t decompressedSize(const uint8_t * source, uint64_t size) const;
+
+	/// @brief Decompress source into a caller-provided buffer. The last codec of every block writes directly to dest.
+	/// @param source Pointer to compressed data.
+	/// @param size Size of compressed data.
+	/// @param dest Pointer to destination buffer.
+	/// @param destSize Size of destination buffer. Must be at least decompressedSize(source, size).
+	/// @return Number of bytes written to dest. 0 if decompression failed.
+	/// @note All necessary information for decompression will be extracted from source if it was
+	/// compressed with compress() before. If not compression will fail. Old "CMP5" data can be decompressed too.
+	uint64_t decompress(const uint8_t * source, uint64_t size, uint8_t * dest, uint64_t destSize) const;
 
 	/// @brief Decompress source and return result.
 	/// @param source Source data.
 	/// @return Decompressed data. Empty if decompression failed.
 	/// @note All necessary information for decompression will be extracted from source if it was
-	/// compressed with compress() before. If not compression will fail.
-	std::vector<uint8_t> decompress(const std::vector<uint8_t> source) const;
+	/// compressed with compress() before. If not compression will fail. Old "CMP5" data can be decompressed too.
+	std::vector<uint8_t> decompress(const std::vector<uint8_t> & source) const;
+
+	/// @brief Compress data from a stream and write the result to another stream. Only one block per thread is held in memory at a time,
+	/// so the memory needed does not depend on the size of the data.
+	/// @param source Source stream. Data is read from the current position.
+	/// @param sourceSize Number of bytes to read from source.
+	/// @param dest Destination stream.
+	/// @param codecs List of pre-configured codecs to use for compression, in this particular order.
+	/// @return Number of bytes written to dest. 0 if compression failed.
+	uint64_t compress(std::istream & source, uint64_t sourceSize, std::ostream & dest, const std::vector<I_Codec::SPtr> & codecs) const;
+
+	/// @brief Decompress data from a stream and write the result to another stream. Only one block per thread is held in memory at a time,
+	/// so the memory needed does not depend on the size of the data. Old "CMP5" data is read to memory completely though.
+	/// @param source Source stream. Data is read from the current position.
+	/// @param dest Destination stream.
+	/// @return Number of bytes written to dest. 0 if decompression failed.
+	uint64_t decompress(std::istream & source, std::ostream & dest) const;
 
 protected:
+	/// @brief Size of the container header in bytes.
+	static const uint32_t HeaderSize;
+
+	/// @brief Size of a block header without codec identifiers in bytes.
+	static const uint32_t BlockHeaderSize;
+
+	/// @brief Maximum size of the data between two codecs of a block. Codec output that is bigger is not stored when compressing
+	/// and rejected when decompressing, so corrupt size fields can not make the decoder allocate huge buffers.
+	/// @param blockSize Uncompressed block size.
+	/// @return Returns twice the block size plus room for codec headers.
+	static uint64_t maxIntermediateSize(uint32_t blockSize);
+
+	/// @brief Memory a thread reuses for (de-)compressing blocks.
+	struct BlockWorkspace
+	{
+		std::vector<uint8_t> buffers[2]; /// @brief Buffers the codecs alternate between. They only grow.
+		Workspace codecWorkspace; /// @brief Scratch memory for codecs.
+		std::map<uint8_t, I_Codec::SPtr> decoders; /// @brief Decoder instances by codec identifier.
+	};
+
+	/// @brief Make sure there is a workspace for every thread. Must be called before starting threads.
+	/// @param count Number of threads that will (de-)compress blocks.
+	void prepareWorkspaces(uint32_t count) const;
+
+	/// @brief Write container header.
+	/// @param dest Destination for HeaderSize bytes of header data.
+	/// @param uncompressedSize Size of uncompressed data.
+	void writeHeader(uint8_t * dest, uint64_t uncompressedSize) const;
+
+	/// @brief Number of threads to use for (de-)compression.
+	uint32_t threadCount() const;
+
+	/// @brief Run block data through all codecs.
+	/// @param source Pointer to uncompressed block data.
+	/// @param size Size of uncompressed block data.
+	/// @param codecs List of codecs to apply, in this particular order.
+	/// @param dest Destination for the compressed block including block header. Must have room for BlockHeaderSize + size bytes.
+	/// @param workspace Memory of the calling thread.
+	/// @return Size of compressed block including block header. The block is stored uncompressed if the codecs failed, did not reduce the size
+	/// or produced intermediate data bigger than maxIntermediateSize().
+	uint32_t compressBlock(const uint8_t * source, uint32_t size, const std::vector<I_Codec::SPtr> & codecs, uint8_t * dest, BlockWorkspace & workspace) const;
+
+	/// @brief Decode block data using the codecs given and store the result in dest.
+	/// @param source Pointer to compressed block data following the block header.
+	/// @param size Size of compressed block data.
+	/// @param codecs Codec identifiers in the order they were applied when encoding.
+	/// @param dest Pointer to destination for uncompressed block data.
+	/// @param destSize Expected size of uncompressed block data.
+	/// @param workspace Memory of the calling thread.
+	/// @return Returns true if decoding worked and the size of the uncompressed block data matched.
+	/// Returns false if a codec would produce intermediate data bigger than maxIntermediateSize().
+	bool decompressBlock(const uint8_t * source, uint32_t size, const std::vector<uint8_t> & codecs, uint8_t * dest, uint32_t destSize, BlockWorkspace & workspace) const;
+
+	/// @brief Decompress old single-block "CMP5" data.
+	/// @param source Pointer to compressed data.
+	/// @param size Size of compressed data.
+	/// @param dest Pointer to destination buffer.
+	/// @param destSize Size of destination buffer.
+	/// @return Number of bytes written to dest. 0 if decompression failed.
+	uint64_t decompressCmp5(const uint8_t * source, uint64_t size, uint8_t * dest, uint64_t destSize) const;
+
 	/// @brief If true the routines output more information about the (de-)compression operation.
 	bool m_verbose = false;
 
+	/// @brief Size of uncompressed blocks.
+	uint32_t m_blockSize = DefaultBlockSize;
+
+	/// @brief Number of threads to use. 0 means all hardware threads.
+	uint32_t m_threadCount = 0;
+
+	/// @brief Dictionary handed to the decoders. nullptr if none is set.
+	std::shared_ptr<const std::vector<uint8_t>> m_dictionary;
+
+	/// @brief Memory reused between calls, one per thread.
+	mutable std::vector<BlockWorkspace> m_workspaces;
+
 	/// @brief Map of available codecs sorted by their identifier.
 	static const std::map<uint8_t, I_Codec::Creator> m_codecs;
 };
\ No newline at end of file
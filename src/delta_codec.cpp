@@ -18,18 +18,22 @@ Delta * Delta::Create()
 	return new Delta();
 }
 
-std::vector<uint8_t> Delta::encode(const std::vector<uint8_t> & source) const
+size_t Delta::encodeBound(size_t size) const
 {
-	const uint32_t srcSize = static_cast<uint32_t>(source.size());
-	if (srcSize > 0)
+	return size;
+}
+
+size_t Delta::encodeInto(const uint8_t * source, size_t size, uint8_t * dest, size_t destSize, Workspace & /*workspace*/) const
+{
+	const size_t srcSize = size;
+	if (srcSize > 0 && destSize >= srcSize)
 	{
-		std::vector<uint8_t> dest(srcSize);
-		uint32_t destIndex = 0;
+		size_t destIndex = 0;
 		//output first symbol verbatim
 		dest[destIndex++] = source[0];
 		int16_t lastSymbol = source[0];
 		//output deltas
-		for (uint32_t i = 1; i < srcSize; ++i)
+		for (size_t i = 1; i < srcSize; ++i)
 		{
 			const int16_t symbol = source[i];
 			//calculate delta and wrap around absolute values higher that 128
@@ -39,26 +43,27 @@ std::vector<uint8_t> Delta::encode(const std::vector<uint8_t> & source) const
 			dest[destIndex++] = zigZag;
 			lastSymbol = symbol;
 		}
-		return dest;
+		return destIndex;
 	}
-	return std::vector<uint8_t>();
+	return 0;
+}
+
+size_t Delta::decodedSize(const uint8_t * /*source*/, size_t size) const
+{
+	return size;
 }
 
-std::vector<uint8_t> Delta::decode(const std::vector<uint8_t> & source) const
+size_t Delta::decodeInto(const uint8_t * source, size_t size, uint8_t * dest, size_t destSize, Workspace & /*workspace*/) const
 {
-	const uint32_t srcSize = static_cast<uint32_t>(source.size());
-	if (srcSize > 0)
+	const size_t srcSize = size;
+	if (srcSize > 0 && destSize >= srcSize)
 	{
-		//read result size
-		uint32_t srcIndex = 0;
-		//allocate destination data
-		std::vector<uint8_t> dest(srcSize);
-		uint32_t destIndex = 0;
+		size_t destIndex = 0;
 		//read first symbol verbatim
 		uint8_t lastSymbol = source[0];
 		dest[destIndex++] = lastSymbol;
 		//output deltas
-		for (uint32_t i = 1; i < srcSize; ++i)
+		for (size_t i = 1; i < srcSize; ++i)
 		{
 			const uint8_t zigZag = source[i];
 			//reverse zig-zag encoding
@@ -68,7 +73,89 @@ std::vector<uint8_t> Delta::decode(const std::vector<uint8_t> & source) const
 			dest[destIndex++] = value;
 			lastSymbol = value;
 		}
-		return dest;
+		return destIndex;
+	}
+	return 0;
+}
+
+/// @brief Incremental delta encoder. Only needs to remember the last symbol.
+class DeltaEncodeStream : public I_CodecStream
+{
+public:
+	virtual bool push(const uint8_t * data, size_t size, std::vector<uint8_t> & output) override
+	{
+		for (size_t i = 0; i < size; ++i)
+		{
+			const int16_t symbol = data[i];
+			if (m_first)
+			{
+				//output first symbol verbatim
+				output.push_back(data[i]);
+				m_first = false;
+			}
+			else
+			{
+				//calculate delta, wrap around and zig-zag encode like encode() does
+				int16_t delta = (int8_t)((m_lastSymbol - symbol) ^ 256);
+				output.push_back((uint8_t)((delta << 1) ^ (delta >> 16)));
+			}
+			m_lastSymbol = symbol;
+		}
+		return true;
+	}
+
+	virtual bool finish(std::vector<uint8_t> & /*output*/) override
+	{
+		return true;
+	}
+
+private:
+	bool m_first = true;
+	int16_t m_lastSymbol = 0;
+};
+
+/// @brief Incremental delta decoder. Only needs to remember the last symbol.
+class DeltaDecodeStream : public I_CodecStream
+{
+public:
+	virtual bool push(const uint8_t * data, size_t size, std::vector<uint8_t> & output) override
+	{
+		for (size_t i = 0; i < size; ++i)
+		{
+			if (m_first)
+			{
+				//read first symbol verbatim
+				m_lastSymbol = data[i];
+				m_first = false;
+			}
+			else
+			{
+				//reverse zig-zag encoding and calculate value from last value and delta
+				const uint8_t zigZag = data[i];
+				int16_t delta = ((uint16_t)zigZag >> 1) ^ (-((uint16_t)zigZag & 1));
+				m_lastSymbol = (uint8_t)(m_lastSymbol - delta);
+			}
+			output.push_back(m_lastSymbol);
+		}
+		return true;
+	}
+
+	virtual bool finish(std::vector<uint8_t> & /*output*/) override
+	{
+		return true;
 	}
-	return std::vector<uint8_t>();
+
+private:
+	bool m_first = true;
+	uint8_t m_lastSymbol = 0;
+};
+
+I_CodecStream::SPtr Delta::createEncodeStream(uint64_t /*sourceSize*/) const
+{
+	return std::make_shared<DeltaEncodeStream>();
+}
+
+I_CodecStream::SPtr Delta::createDecodeStream() const
+{
+	return std::make_shared<DeltaDecodeStream>();
 }
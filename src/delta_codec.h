@@ -22,19 +22,47 @@ public:
 	/// @return Codec name.
 	virtual std::string codecName() const override;
 
+	/// @brief Worst-case size of the data encodeInto() produces with the current settings.
+	/// @param size Size of source data.
+	/// @return Returns size, as delta encoding does not change the size of data.
+	virtual size_t encodeBound(size_t size) const override;
+
 	/// @brief Encode source data to dest using delta- and zig-zag encoding.
 	/// The code does (int8_t)((int16_t)a - (int16_t)b) ^ 256 to clamp value to the range [-128, 128].
 	/// Then those values are then zig-zag encoded using (n << 1) ^ (n >> 15) so they map to [0, 255].
 	/// The zig-zag encoding groups small absolute value, because it maps -1 to 1, 1 to 2 and so forth.
 	/// The encoding can be reversed using (n >> 1) ^ (-(n & 1)).
 	/// See: https://developers.google.com/protocol-buffers/docs/encoding#signed-integers
-	/// @param source Source data.
-	/// @return Encoded result.
-	virtual std::vector<uint8_t> encode(const std::vector<uint8_t> & source) const override;
+	/// @param source Pointer to source data.
+	/// @param size Size of source data.
+	/// @param dest Pointer to destination buffer.
+	/// @param destSize Size of destination buffer. Must be at least encodeBound(size).
+	/// @param workspace Scratch memory reused across calls.
+	/// @return Number of bytes written to dest. 0 if encoding failed.
+	virtual size_t encodeInto(const uint8_t * source, size_t size, uint8_t * dest, size_t destSize, Workspace & workspace) const override;
+
+	/// @brief Size of the data decodeInto() produces.
+	/// @param source Pointer to compressed data.
+	/// @param size Size of compressed data.
+	/// @return Returns size, as delta encoding does not change the size of data.
+	virtual size_t decodedSize(const uint8_t * source, size_t size) const override;
 
 	/// @brief Decode delta- and zig-zag-encoded source data to dest.
-	/// @param source Source data.
-	/// @return Decoded result.
-	virtual std::vector<uint8_t> decode(const std::vector<uint8_t> & source) const override;
+	/// @param source Pointer to compressed data.
+	/// @param size Size of compressed data.
+	/// @param dest Pointer to destination buffer.
+	/// @param destSize Size of destination buffer. Must be at least decodedSize(source, size).
+	/// @param workspace Scratch memory reused across calls.
+	/// @return Number of bytes written to dest. 0 if decoding failed.
+	virtual size_t decodeInto(const uint8_t * source, size_t size, uint8_t * dest, size_t destSize, Workspace & workspace) const override;
+
+	/// @brief Create an incremental encoder producing the same output as encode().
+	/// @param sourceSize Total size of input. Not needed for this codec.
+	/// @return Encoder stream.
+	virtual I_CodecStream::SPtr createEncodeStream(uint64_t sourceSize = 0) const override;
+
+	/// @brief Create an incremental decoder for data produced by encode().
+	/// @return Decoder stream.
+	virtual I_CodecStream::SPtr createDecodeStream() const override;
 
 };
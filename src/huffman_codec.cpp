@@ -2,22 +2,36 @@
 
 #include "tools.h"
 #include <array>
-#include <queue>
 #include <algorithm>
 #include <iostream>
 #include <numeric>
+#include <cstring>
+#include <atomic>
 
 
 const uint8_t StaticHuffman::CodecIdentifier = 60;
+const uint8_t StaticHuffman::CodecIdentifierInterleaved = 61;
+const uint8_t StaticHuffman::CodecIdentifierBlocked = 62;
+const uint32_t StaticHuffman::MinBlockSize = 4096;
+const uint32_t StaticHuffman::MaxBlockSize = 16 * 1024 * 1024;
+const uint32_t StaticHuffman::DefaultBlockSize = 64 * 1024;
 
 uint8_t StaticHuffman::codecIdentifier() const
 {
-	return CodecIdentifier;
+	if (m_blockSize > 0)
+	{
+		return CodecIdentifierBlocked;
+	}
+	return m_streamCount > 1 ? CodecIdentifierInterleaved : CodecIdentifier;
 }
 
 std::string StaticHuffman::codecName() const
 {
-	return "Static Huffman";
+	if (m_blockSize > 0)
+	{
+		return "Block-adaptive static Huffman";
+	}
+	return m_streamCount > 1 ? "Interleaved static Huffman" : "Static Huffman";
 }
 
 StaticHuffman * StaticHuffman::Create()
@@ -25,240 +39,289 @@ StaticHuffman * StaticHuffman::Create()
 	return new StaticHuffman();
 }
 
+StaticHuffman * StaticHuffman::CreateInterleaved()
+{
+	StaticHuffman * codec = new StaticHuffman();
+	codec->setStreamCount(4);
+	return codec;
+}
+
+StaticHuffman * StaticHuffman::CreateBlocked()
+{
+	StaticHuffman * codec = new StaticHuffman();
+	codec->setBlockSize(DefaultBlockSize);
+	return codec;
+}
+
 void StaticHuffman::setDecodeMethod(uint32_t method)
 {
 	m_decodeMethod = method;
 }
 
+void StaticHuffman::setStreamCount(uint32_t streamCount)
+{
+	if (streamCount == 1 || streamCount == 4 || streamCount == 8)
+	{
+		m_streamCount = streamCount;
+	}
+}
+
+void StaticHuffman::setBlockSize(uint32_t blockSize)
+{
+	m_blockSize = blockSize > 0 ? std::min(std::max(blockSize, MinBlockSize), MaxBlockSize) : 0;
+}
+
 //-------------------------------------------------------------------------------------------------
 
-StaticHuffman::Frequencies StaticHuffman::frequenciesFromData(const std::vector<uint8_t> & source) const
+StaticHuffman::Frequencies StaticHuffman::frequenciesFromData(const uint8_t * source, size_t size) const
 {
 	//count frequencies in data
-	Frequencies frequencies;
-	std::fill(frequencies.begin(), frequencies.end(), 0);
-	for (uint32_t i = 0; i < source.size(); ++i)
+	std::array<uint64_t, 256> counts;
+	Tools::histogram(source, size, counts.data(), threadCount());
+	//divide if the counts would not fit into 32 bits
+	uint32_t shift = 0;
+	while ((static_cast<uint64_t>(size) >> shift) > UINT32_MAX)
 	{
-		frequencies[source[i]]++;
+		shift++;
 	}
-	//just halve frequencies
-	uint32_t minimum = UINT32_MAX;
+	Frequencies frequencies;
 	for (uint32_t i = 0; i < 256; ++i)
 	{
-		if (frequencies[i] > 0)
-		{
-			minimum = (frequencies[i] < minimum) ? frequencies[i] : minimum;
-		}
+		//adjust frequencies by dividing, but make sure frequencies > 0 stay > 0
+		frequencies[i] = counts[i] > 0 ? static_cast<uint32_t>(std::max<uint64_t>(counts[i] >> shift, 1)) : 0;
 	}
-	//find out what to divide by
-	const uint32_t shift = minimum > 2 ? Tools::highestBitSet(minimum) : 0;
-	if (shift > 0)
+	return frequencies;
+}
+
+//-------------------------------------------------------------------------------------------------
+
+HuffmanCodes StaticHuffman::codesFromFrequencies(const Frequencies & frequencies, uint8_t allowedCodeLength) const
+{
+	HuffmanCodes codes = buildCanonicalCodes(frequencies.data(), 256, allowedCodeLength);
+	if (m_verbose)
 	{
-		for (uint32_t i = 0; i < 256; ++i)
+		uint32_t maxCodeLength = 0;
+		for (const auto & code : codes)
 		{
-			//adjust frequencies by dividing, but make sure frequencies > 0 stay > 0
-			if (frequencies[i] > 0)
-			{
-				frequencies[i] = (frequencies[i] >> shift) | 1;
-			}
+			maxCodeLength = std::max<uint32_t>(maxCodeLength, code.length);
 		}
+		std::cout << "Maximum code length is " << maxCodeLength << "." << std::endl;
 	}
-	return frequencies;
+	return codes;
 }
 
 //-------------------------------------------------------------------------------------------------
 
-struct TreeNode
+/// @brief Output the code lengths of all 256 symbols as nibbles.
+static void writeCodeLengths(const std::array<uint8_t, 256> & lengths, uint8_t * dest, size_t & destIndex)
 {
-	TreeNode * parent; /// @brief Parent node in tree. Uninitialized nodes and the root node has parent == NULL.
-	TreeNode * leftChild; /// @brief left side child index of this node. valid if != NULL.
-	TreeNode * rightChild; /// @brief right side child index of this node. valid if != NULL.
-	uint32_t weight; /// @brief The frequency or weight of the node.
-	uint8_t symbol; /// @brief The actual symbol value if this is a leaf node (leftChild == 0 && rightChild == 0).
-};
+	for (uint32_t i = 0; i < 256; i += 2)
+	{
+		dest[destIndex++] = static_cast<uint8_t>((lengths[i] << 4) | lengths[i + 1]);
+	}
+}
 
-class SortByWeightAscending
+/// @brief Output a bitmap of the used symbols, followed by the code lengths of the used symbols as nibbles.
+static void writeUsedCodeLengths(const std::array<uint8_t, 256> & lengths, uint8_t * dest, size_t & destIndex)
 {
-public:
-	bool operator()(const TreeNode * a, const TreeNode * b) const
+	std::fill_n(dest + destIndex, 32, 0);
+	for (uint32_t i = 0; i < 256; ++i)
 	{
-		return a->weight > b->weight;
+		dest[destIndex + i / 8] |= lengths[i] > 0 ? 0x80 >> (i & 7) : 0;
 	}
-};
+	destIndex += 32;
+	uint32_t nibbleCount = 0;
+	for (uint32_t i = 0; i < 256; ++i)
+	{
+		if (lengths[i] > 0)
+		{
+			if ((nibbleCount++ & 1) == 0)
+			{
+				dest[destIndex++] = static_cast<uint8_t>(lengths[i] << 4);
+			}
+			else
+			{
+				dest[destIndex - 1] |= lengths[i];
+			}
+		}
+	}
+}
 
-void buildCodesFromTree(HuffmanCodes & codes, TreeNode * node, uint16_t code = 0, uint8_t codeLength = 0)
+/// @brief Output data as streamCount streams. For more than one stream the sizes of all streams but the last are stored first.
+static void encodeStreams(const uint8_t * source, size_t size, const HuffmanCodes & codes, uint32_t streamCount, uint8_t * dest, size_t & destIndex)
 {
-	//check if it is a leaf node and not an intermediate one
-	if (node->leftChild == nullptr && node->rightChild == nullptr)
+	//output compressed data of a part of the source
+	const auto encodePart = [&](const uint8_t * part, size_t partSize)
 	{
-		//assign code to current node
-		if (node->weight > 0)
+		uint32_t buffer = 0; //bit buffer holding encoded data
+		uint32_t availableBits = 32; //number of available bits in buffer we can fill with data
+		for (size_t i = 0; i < partSize; ++i)
 		{
-			codes[node->symbol].symbol = node->symbol;
-			codes[node->symbol].code = code;
-			codes[node->symbol].length = codeLength;
+			const uint8_t symbol = part[i];
+			//get code for symbol from Huffman table and insert at current bit position in buffer
+			buffer |= (uint32_t)codes[symbol].code << (availableBits - codes[symbol].length);
+			availableBits -= codes[symbol].length;
+			//if the buffer has a short or byte available, output it
+			Tools::outputBits(dest, destIndex, buffer, availableBits);
 		}
-		else
+		//now if we still have remaining bits, dump buffer byte, which automatically adds the bits plus trailing zero bits
+		Tools::outputBits(dest, destIndex, buffer, availableBits, true);
+	};
+	if (streamCount > 1)
+	{
+		//leave room for the stream sizes and encode the streams behind it
+		const size_t sizesIndex = destIndex;
+		destIndex += (streamCount - 1) * Tools::MaxSizeBytes;
+		const size_t streamsIndex = destIndex;
+		const size_t partSize = size / streamCount;
+		std::array<size_t, 8> streamSizes;
+		for (uint32_t i = 0; i < streamCount; ++i)
 		{
-			codes[node->symbol].symbol = node->symbol;
-			codes[node->symbol].code = 0;
-			codes[node->symbol].length = 255;
+			const size_t streamStart = destIndex;
+			encodePart(source + i * partSize, i < streamCount - 1 ? partSize : size - i * partSize);
+			streamSizes[i] = destIndex - streamStart;
 		}
+		//store the stream sizes and move the streams right behind them
+		size_t index = sizesIndex;
+		for (uint32_t i = 0; i < streamCount - 1; ++i)
+		{
+			Tools::writeSize(dest, index, streamSizes[i]);
+		}
+		std::memmove(dest + index, dest + streamsIndex, destIndex - streamsIndex);
+		destIndex = index + (destIndex - streamsIndex);
 	}
-	//assign a 0 for a left node child, a 1 for a right node child
-	if (node->leftChild != nullptr)
-	{
-		buildCodesFromTree(codes, node->leftChild, code << 1, codeLength + 1);
-	}
-	if (node->rightChild != nullptr)
+	else
 	{
-		buildCodesFromTree(codes, node->rightChild, (code << 1) | 1, codeLength + 1);
+		encodePart(source, size);
 	}
 }
 
-void deleteTreeNodes(TreeNode * node)
+size_t StaticHuffman::encodeBound(size_t size) const
 {
-	if (node->leftChild != nullptr)
+	//size + stream count + code length table + stream sizes + 15 bits per symbol + remaining bits in bit buffer of every stream
+	if (m_blockSize > 0)
 	{
-		deleteTreeNodes(node->leftChild);
+		//every block has a mode byte, a code length table, its size and stream sizes
+		const size_t nrOfBlocks = (size + m_blockSize - 1) / m_blockSize;
+		const size_t blockOverhead = 1 + 128 + 4 + (m_streamCount - 1) * Tools::MaxSizeBytes + 4 * m_streamCount;
+		return 2 * Tools::MaxSizeBytes + 1 + nrOfBlocks * blockOverhead + (size * 15 + 7) / 8;
 	}
-	if (node->rightChild != nullptr)
+	if (m_streamCount > 1)
 	{
-		deleteTreeNodes(node->rightChild);
+		return Tools::MaxSizeBytes + 1 + 128 + (m_streamCount - 1) * Tools::MaxSizeBytes + (size * 15 + 7) / 8 + 4 * m_streamCount;
 	}
-	delete node;
+	return Tools::MaxSizeBytes + 128 + (size * 15 + 7) / 8 + 4;
 }
 
-HuffmanCodes StaticHuffman::codesFromFrequencies(StaticHuffman::Frequencies frequencies, uint8_t allowedCodeLength) const
+size_t StaticHuffman::encodeInto(const uint8_t * source, size_t size, uint8_t * dest, size_t destSize, Workspace & /*workspace*/) const
 {
-	HuffmanCodes codes(256);
-	//loop while the maximum code length has been exceeded
-	uint8_t maxCodeLength = 0;
-	do
+	const size_t srcSize = size;
+	if (srcSize > 0 && destSize >= encodeBound(srcSize))
 	{
-		std::vector<TreeNode*> nodes(256);
-		std::priority_queue<TreeNode*, std::vector<TreeNode*>, SortByWeightAscending> queue;
-		//initialize leaves from frequencies
-		for (uint32_t i = 0; i < 256; ++i)
+		if (m_blockSize > 0)
 		{
-			TreeNode * leaf = new TreeNode();
-			leaf->parent = NULL;
-			leaf->leftChild = NULL;
-			leaf->rightChild = NULL;
-			leaf->symbol = i;
-			leaf->weight = frequencies[i];
-			queue.push(leaf);
-		}
-		//now start building tree. when only the root node is left, we are done.
-		while (queue.size() > 1)
-		{
-			//remove the two nodes of lowest probability
-			TreeNode * left = queue.top(); queue.pop();
-			TreeNode * right = queue.top(); queue.pop();
-			//build new node combining frequencies
-			TreeNode * combined = new TreeNode();
-			combined->parent = NULL;
-			combined->leftChild = left;
-			combined->rightChild = right;
-			combined->weight = left->weight + right->weight;
-			combined->symbol = 0;
-			left->parent = combined;
-			right->parent = combined;
-			queue.push(combined);
-		}
-		//now build codes from tree
-		TreeNode * root = queue.top(); queue.pop();
-		buildCodesFromTree(codes, root);
-		//convert to canonical codes
-		codes = convertToCanonicalCodes(codes);
-		//free data
-		deleteTreeNodes(root);
-		//check if maximum code length is ok
-		maxCodeLength = 0;
-		auto citer = codes.cbegin();
-		while (citer != codes.cend())
-		{
-			maxCodeLength = maxCodeLength < citer->length ? citer->length : maxCodeLength;
-			++citer;
-		}
-		if (maxCodeLength > allowedCodeLength)
-		{
-			if (m_verbose) std::cout << "Maximum code length is " << (uint32_t)maxCodeLength << ". Reducing..." << std::endl;
-			//reduce frequencies and build codes again
-			auto fiter = frequencies.begin();
-			while (fiter != frequencies.end())
-			{
-				*fiter = *fiter > 0 ? (*fiter >> 1) | 1 : *fiter;
-				++fiter;
-			}
+			return encodeBlocks(source, srcSize, dest);
 		}
-	} while (maxCodeLength > allowedCodeLength);
-	if (m_verbose) std::cout << "Maximum code length is " << (uint32_t)maxCodeLength << "." << std::endl;
-	//Dump codes
-	/*std::cout << "Huffman codes:" << std::endl;
-	for (uint16_t i = 0; i < 256; ++i)
-	{
-	std::cout << (uint32_t)codes[i].code << std::endl;
-	}*/
-	return codes;
-}
-
-//-------------------------------------------------------------------------------------------------
-
-std::vector<uint8_t> StaticHuffman::encode(const std::vector<uint8_t> & source) const
-{
-	const uint32_t srcSize = static_cast<uint32_t>(source.size());
-	if (srcSize > 0)
-	{
-		std::vector<uint8_t> dest(srcSize + 4 + 128 + (srcSize / 8));
-		uint32_t destIndex = 0;
+		size_t destIndex = 0;
 		//output source size
-		*((uint32_t *)&dest[destIndex]) = srcSize;
-		destIndex += 4;
+		Tools::writeSize(dest, destIndex, srcSize);
+		if (m_streamCount > 1)
+		{
+			dest[destIndex++] = static_cast<uint8_t>(m_streamCount);
+		}
 		//build Huffman codes from data
 		if (m_verbose) std::cout << "Generating Huffman codes... ";
-		Frequencies frequencies = frequenciesFromData(source);
-		HuffmanCodes codes = codesFromFrequencies(frequencies);
+		const Frequencies frequencies = frequenciesFromData(source, srcSize);
+		//the codes are sorted by symbol for easier encoding
+		const HuffmanCodes codes = codesFromFrequencies(frequencies);
 		if (m_verbose) std::cout << "Done." << std::endl;
 		if (m_verbose) std::cout << "Compressing with static Huffman encoder... ";
-		//the codes ascending by symbols for easier encoding
-		std::sort(codes.begin(), codes.end(), [](const HuffmanCode & a, const HuffmanCode & b){ return a.symbol < b.symbol; });
-		//output code lengths
-		uint32_t buffer = 0; //bit buffer holding encoded data
-		uint32_t availableBits = 32; //number of available bits in buffer we can fill with data
+		//output code lengths and compressed data
+		CodeLengths lengths;
 		for (uint32_t i = 0; i < 256; ++i)
 		{
-			const uint32_t length = (codes.at(i).length <= 15) ? codes.at(i).length : 0;
-			//convert length to nibble and store in buffer
-			buffer |= length << (availableBits - 4);
-			availableBits -= 4;
-			//if the buffer has a short or byte available, output it
-			Tools::outputBits(dest, destIndex, buffer, availableBits);
+			lengths[i] = codes[i].length <= 15 ? codes[i].length : 0;
 		}
-		//output compressed data
-		buffer = 0;
-		availableBits = 32;
-		for (uint32_t i = 0; i < srcSize; ++i)
+		writeCodeLengths(lengths, dest, destIndex);
+		encodeStreams(source, srcSize, codes, m_streamCount, dest, destIndex);
+		if (m_verbose) std::cout << "Done." << std::endl;
+		return destIndex;
+	}
+	return 0;
+}
+
+size_t StaticHuffman::encodeBlocks(const uint8_t * source, size_t size, uint8_t * dest) const
+{
+	size_t destIndex = 0;
+	//output source size, block size and stream count
+	Tools::writeSize(dest, destIndex, size);
+	Tools::writeSize(dest, destIndex, m_blockSize);
+	dest[destIndex++] = static_cast<uint8_t>(m_streamCount);
+	if (m_verbose) std::cout << "Compressing with block-adaptive static Huffman encoder... ";
+	CodeLengths previousLengths = {};
+	HuffmanCodes codes;
+	uint64_t nrOfTables = 0;
+	for (size_t blockStart = 0; blockStart < size; blockStart += m_blockSize)
+	{
+		const size_t blockSize = std::min<size_t>(m_blockSize, size - blockStart);
+		//build optimal codes for the block
+		std::array<uint64_t, 256> counts;
+		Tools::histogram(source + blockStart, blockSize, counts.data());
+		Frequencies frequencies;
+		for (uint32_t i = 0; i < 256; ++i)
 		{
-			const uint8_t symbol = source[i];
-			//get code for symbol from Huffman table and insert at current bit position in buffer
-			buffer |= (uint32_t)codes.at(symbol).code << (availableBits - codes.at(symbol).length);
-			availableBits -= codes.at(symbol).length;
-			//if the buffer has a short or byte available, output it
-			Tools::outputBits(dest, destIndex, buffer, availableBits);
+			frequencies[i] = static_cast<uint32_t>(counts[i]);
 		}
-		//now if we still have remaining bits, dump buffer byte, which automatically adds the bits plus trailing zero bits
-		Tools::outputBits(dest, destIndex, buffer, availableBits, true);
-		if (m_verbose) std::cout << "Done." << std::endl;
-		dest.resize(destIndex);
-		return dest;
+		CodeLengths lengths;
+		buildCodeLengths(frequencies.data(), 256, 15, lengths.data());
+		//calculate the size of the block with its own codes and the codes of the previous block, if they have all symbols
+		uint64_t bits = 0;
+		uint64_t previousBits = 0;
+		uint32_t usedCount = 0;
+		bool previousUsable = nrOfTables > 0;
+		for (uint32_t i = 0; i < 256; ++i)
+		{
+			bits += counts[i] * lengths[i];
+			previousBits += counts[i] * previousLengths[i];
+			usedCount += lengths[i] > 0 ? 1 : 0;
+			previousUsable = previousUsable && (counts[i] == 0 || previousLengths[i] > 0);
+		}
+		//store the lengths of the used symbols only, if that is smaller than storing all lengths
+		const uint32_t usedTableSize = 32 + (usedCount + 1) / 2;
+		const uint32_t tableSize = std::min<uint32_t>(128, usedTableSize);
+		if (previousUsable && (previousBits + 7) / 8 <= (bits + 7) / 8 + tableSize)
+		{
+			dest[destIndex++] = 0;
+		}
+		else
+		{
+			if (usedTableSize < 128)
+			{
+				dest[destIndex++] = 2;
+				writeUsedCodeLengths(lengths, dest, destIndex);
+			}
+			else
+			{
+				dest[destIndex++] = 1;
+				writeCodeLengths(lengths, dest, destIndex);
+			}
+			previousLengths = lengths;
+			codes = canonicalCodesFromLengths(lengths.data(), 256);
+			nrOfTables++;
+		}
+		//output compressed data behind its size. blocks are at most 16MB, so the size always takes 4 bytes
+		size_t sizeIndex = destIndex;
+		destIndex += 4;
+		encodeStreams(source + blockStart, blockSize, codes, m_streamCount, dest, destIndex);
+		Tools::writeSize(dest, sizeIndex, destIndex - sizeIndex - 4);
 	}
-	return std::vector<uint8_t>();
+	if (m_verbose) std::cout << "Done. Used " << nrOfTables << " code table(s) for " << (size + m_blockSize - 1) / m_blockSize << " block(s)." << std::endl;
+	return destIndex;
 }
 
 //------------------------------------------------------------------------------------------------
 
-StaticHuffman::CodeLengths StaticHuffman::getCodeLengthsFromHeader(const std::vector<uint8_t> & source, uint32_t & index, uint8_t & minLength, uint8_t & maxLength) const
+StaticHuffman::CodeLengths StaticHuffman::getCodeLengthsFromHeader(const uint8_t * source, size_t & index, uint8_t & minLength, uint8_t & maxLength) const
 {
 	//read code lengths from data
 	CodeLengths codeLengths;
@@ -280,13 +343,14 @@ StaticHuffman::CodeLengths StaticHuffman::getCodeLengthsFromHeader(const std::ve
 	return codeLengths;
 }
 
-HuffmanCodes StaticHuffman::getCodesFromHeader(const std::vector<uint8_t> & source) const
+HuffmanCodes StaticHuffman::getCodesFromHeader(const uint8_t * source, size_t size) const
 {
 	HuffmanCodes codes(256);
 	//check minimum data size (length size + lengths + uncompressed size)
-	if (source.size() > 132)
+	size_t index = 0;
+	uint64_t destSize = 0;
+	if (Tools::readSize(source, size, index, destSize) && index + 128 <= size)
 	{
-		uint32_t index = 0;
 		//read code lengths from data
 		uint8_t minCodeLength = 15;
 		uint8_t maxCodeLength = 0;
@@ -321,42 +385,57 @@ HuffmanCodes StaticHuffman::getCodesFromHeader(const std::vector<uint8_t> & sour
 
 //------------------------------------------------------------------------------------------------
 
-std::vector<uint8_t> StaticHuffman::decode(const std::vector<uint8_t> & source) const
+size_t StaticHuffman::decodedSize(const uint8_t * source, size_t size) const
 {
+	size_t srcIndex = 0;
+	uint64_t destSize = 0;
+	return Tools::readSize(source, size, srcIndex, destSize) ? static_cast<size_t>(destSize) : 0;
+}
+
+size_t StaticHuffman::decodeInto(const uint8_t * source, size_t size, uint8_t * dest, size_t destSize, Workspace & workspace) const
+{
+	if (m_blockSize > 0)
+	{
+		return decodeBlocks(source, size, dest, destSize, workspace);
+	}
+	if (m_streamCount > 1)
+	{
+		return decodeInterleaved(source, size, dest, destSize, workspace);
+	}
 	//check minimum data size (length size + lengths + uncompressed size)
-	if (source.size() > 132)
+	if (size > 132)
 	{
 		switch (m_decodeMethod)
 		{
 			case 1:
-				return decode1(source);
+				return decode1(source, size, dest, destSize);
 				break;
 			case 2:
-				return decode2(source);
+				return decode2(source, size, dest, destSize);
 				break;
 			case 3:
-				return decode3(source);
+				return decode3(source, size, dest, destSize);
+				break;
+			case 4:
+				return decode4(source, size, dest, destSize, workspace);
 				break;
 			default:
-				return decode0(source);
+				return decode0(source, size, dest, destSize);
 				break;
 		}
 	}
-	return std::vector<uint8_t>();
+	return 0;
 }
 
-std::vector<uint8_t> StaticHuffman::decode0(const std::vector<uint8_t> & source) const
+size_t StaticHuffman::decode0(const uint8_t * source, size_t size, uint8_t * dest, size_t destCapacity) const
 {
-	const uint32_t srcSize = static_cast<uint32_t>(source.size());
-	if (srcSize > 132)
+	const size_t srcSize = size;
+	//read result size
+	size_t srcIndex = 0;
+	uint64_t destSize = 0;
+	if (Tools::readSize(source, srcSize, srcIndex, destSize) && destSize <= destCapacity && srcIndex + 128 <= srcSize)
 	{
-		//read result size
-		uint32_t srcIndex = 0;
-		const uint32_t destSize = *((uint32_t *)&source[srcIndex]);
-		srcIndex += 4;
-		//allocate destination data
-		std::vector<uint8_t> dest(destSize);
-		uint32_t destIndex = 0;
+		size_t destIndex = 0;
 		//read code lengths from data
 		uint8_t minCodeLength = 15;
 		uint8_t maxCodeLength = 0;
@@ -399,7 +478,7 @@ std::vector<uint8_t> StaticHuffman::decode0(const std::vector<uint8_t> & source)
 			bits -= 8;
 			//try to match code
 			int8_t codeLength = minCodeLength;
-			while (codeLength <= (32 - bits) && codeLength <= maxCodeLength && destIndex < dest.size())
+			while (codeLength <= (32 - bits) && codeLength <= maxCodeLength && destIndex < destSize)
 			{
 				//read code from buffer and mask with code length
 				const uint16_t codeWord = (uint16_t)(buffer >> (32 - codeLength)) & (0xFFFF >> (16 - codeLength));
@@ -421,23 +500,20 @@ std::vector<uint8_t> StaticHuffman::decode0(const std::vector<uint8_t> & source)
 				codeLength++;
 			}
 		}
-		return dest;
+		return destIndex == destSize ? destIndex : 0;
 	}
-	return std::vector<uint8_t>();
+	return 0;
 }
 
-std::vector<uint8_t> StaticHuffman::decode1(const std::vector<uint8_t> & source) const
+size_t StaticHuffman::decode1(const uint8_t * source, size_t size, uint8_t * dest, size_t destCapacity) const
 {
-	const uint32_t srcSize = static_cast<uint32_t>(source.size());
-	if (srcSize > 132)
+	const size_t srcSize = size;
+	//read result size
+	size_t srcIndex = 0;
+	uint64_t destSize = 0;
+	if (Tools::readSize(source, srcSize, srcIndex, destSize) && destSize <= destCapacity && srcIndex + 128 <= srcSize)
 	{
-		//read result size
-		uint32_t srcIndex = 0;
-		const uint32_t destSize = *((uint32_t *)&source[srcIndex]);
-		srcIndex += 4;
-		//allocate destination data
-		std::vector<uint8_t> dest(destSize);
-		uint32_t destIndex = 0;
+		size_t destIndex = 0;
 		//read code lengths from data
 		uint8_t minCodeLength = 15;
 		uint8_t maxCodeLength = 0;
@@ -493,7 +569,7 @@ std::vector<uint8_t> StaticHuffman::decode1(const std::vector<uint8_t> & source)
 					buffer <<= codeLength;
 					bits += codeLength;
 					//check if want to quit now, or break because there are not enough bits left anyway
-					if (minCodeLength > bits || destIndex >= dest.size())
+					if (minCodeLength > bits || destIndex >= destSize)
 					{
 						break;
 					}
@@ -504,23 +580,20 @@ std::vector<uint8_t> StaticHuffman::decode1(const std::vector<uint8_t> & source)
 				codeLength++;
 			}
 		}
-		return dest;
+		return destIndex == destSize ? destIndex : 0;
 	}
-	return std::vector<uint8_t>();
+	return 0;
 }
 
-std::vector<uint8_t> StaticHuffman::decode2(const std::vector<uint8_t> & source) const
+size_t StaticHuffman::decode2(const uint8_t * source, size_t size, uint8_t * dest, size_t destCapacity) const
 {
-	const uint32_t srcSize = static_cast<uint32_t>(source.size());
-	if (srcSize > 132)
+	const size_t srcSize = size;
+	//read result size
+	size_t srcIndex = 0;
+	uint64_t destSize = 0;
+	if (Tools::readSize(source, srcSize, srcIndex, destSize) && destSize <= destCapacity && srcIndex + 128 <= srcSize)
 	{
-		//read result size
-		uint32_t srcIndex = 0;
-		const uint32_t destSize = *((uint32_t *)&source[srcIndex]);
-		srcIndex += 4;
-		//allocate destination data
-		std::vector<uint8_t> dest(destSize);
-		uint32_t destIndex = 0;
+		size_t destIndex = 0;
 		//read code lengths from data
 		uint8_t minCodeLength = 15;
 		uint8_t maxCodeLength = 0;
@@ -583,33 +656,30 @@ std::vector<uint8_t> StaticHuffman::decode2(const std::vector<uint8_t> & source)
 				codeLength++;
 			}
 		}
-		return dest;
+		return destIndex == destSize ? destIndex : 0;
 	}
-	return std::vector<uint8_t>();
+	return 0;
 }
 
-std::vector<uint8_t> StaticHuffman::decode3(const std::vector<uint8_t> & source) const
+size_t StaticHuffman::decode3(const uint8_t * source, size_t size, uint8_t * dest, size_t destCapacity) const
 {
-	const uint32_t srcSize = static_cast<uint32_t>(source.size());
-	if (srcSize > 132)
+	const size_t srcSize = size;
+	//read result size
+	size_t srcIndex = 0;
+	uint64_t destSize = 0;
+	if (Tools::readSize(source, srcSize, srcIndex, destSize) && destSize <= destCapacity && srcIndex + 128 <= srcSize)
 	{
-		//read result size
-		uint32_t srcIndex = 0;
-		const uint32_t destSize = *((uint32_t *)&source[srcIndex]);
-		srcIndex += 4;
-		//allocate destination data
-		std::vector<uint8_t> dest(destSize);
-		uint32_t destIndex = 0;
+		size_t destIndex = 0;
 		//read code lengths from data
 		uint8_t minCodeLength = 15;
 		uint8_t maxCodeLength = 0;
 		const CodeLengths codeLengths = getCodeLengthsFromHeader(source, srcIndex, minCodeLength, maxCodeLength);
 		//build canonical codes from lengths and sort symbols by codeword length and then symbol index
-		std::array<uint8_t, 16> codeLengthCount;
+		std::array<uint16_t, 16> codeLengthCount;
 		std::iota(codeLengthCount.begin(), codeLengthCount.end(), 0);
 		std::array<uint8_t, 256> symbols;
 		std::iota(symbols.begin(), symbols.end(), 0);
-		uint8_t codeIndex = 0;
+		uint16_t codeIndex = 0;
 		for (uint8_t i = minCodeLength; i <= maxCodeLength; ++i)
 		{
 			codeLengthCount[i] = 0;
@@ -628,7 +698,7 @@ std::vector<uint8_t> StaticHuffman::decode3(const std::vector<uint8_t> & source)
 		uint32_t buffer = 0;
 		uint8_t bits = 0;
 		uint16_t currentCode = 0;
-		uint8_t symbolStartIndex = 0;
+		uint16_t symbolStartIndex = 0;
 		uint8_t currentCodeLength = minCodeLength;
 		while (destIndex < destSize && (srcIndex < srcSize || bits >= minCodeLength))
 		{
@@ -647,7 +717,7 @@ std::vector<uint8_t> StaticHuffman::decode3(const std::vector<uint8_t> & source)
 				if (codeWord >= currentCode)
 				{
 					//calculate absolute index in code array
-					const uint8_t codeIndex = codeWord - currentCode;
+					const uint16_t codeIndex = codeWord - currentCode;
 					//check if code word matches
 					if (codeIndex < codeLengthCount[currentCodeLength])
 					{
@@ -666,8 +736,560 @@ std::vector<uint8_t> StaticHuffman::decode3(const std::vector<uint8_t> & source)
 				symbolStartIndex += codeLengthCount[currentCodeLength];
 				currentCodeLength++;
 			}
+			//no code matched up to the maximum code length. the data is invalid
+			if (currentCodeLength > maxCodeLength)
+			{
+				return 0;
+			}
+		}
+		return destIndex == destSize ? destIndex : 0;
+	}
+	return 0;
+}
+
+/// @brief Number of code bits decode4() looks up at once. The tables fit into the L1 cache, 12 bits is slower.
+static const uint32_t DecodeTableBits = 11;
+/// @brief Number of entries of the decoding tables.
+static const uint32_t DecodeTableSize = 1 << DecodeTableBits;
+
+/// @brief Canonical codes sorted for decoding code words of one length at a time.
+struct HuffmanCanonicalCodes
+{
+	std::array<uint8_t, 256> symbols; /// @brief Symbols sorted by code length and then symbol.
+	std::array<uint32_t, 16> firstCode; /// @brief First code of every length.
+	std::array<uint32_t, 16> codeLengthStart; /// @brief Index of the first symbol of every length.
+	std::array<uint32_t, 16> codeLengthCount; /// @brief Number of codes of every length.
+	uint32_t maxCodeLength;
+};
+
+/// @brief Tables for decoding canonical codes with a table lookup of DecodeTableBits bits.
+struct HuffmanDecodeTables : public HuffmanCanonicalCodes
+{
+	const uint16_t * single; /// @brief Symbol << 4 | length of the first code of an index. 0 if the code is longer.
+	const uint32_t * table; /// @brief Up to 3 symbols in bits 0-23, bits used in bits 24-27 and symbol count in bits 28-29.
+};
+
+/// @brief Sort symbols by code length and then symbol and calculate the first code of every length.
+/// Returns false if there are no codes or the lengths do not form a valid prefix code.
+static bool sortCanonicalCodes(const std::array<uint8_t, 256> & codeLengths, HuffmanCanonicalCodes & codes)
+{
+	uint32_t codeIndex = 0;
+	uint32_t currentCode = 0;
+	codes.maxCodeLength = 0;
+	for (uint32_t length = 1; length <= 15; ++length)
+	{
+		codes.firstCode[length] = currentCode;
+		codes.codeLengthStart[length] = codeIndex;
+		codes.codeLengthCount[length] = 0;
+		for (uint32_t symbol = 0; symbol < 256; ++symbol)
+		{
+			if (codeLengths[symbol] == length)
+			{
+				codes.symbols[codeIndex++] = static_cast<uint8_t>(symbol);
+				codes.codeLengthCount[length]++;
+				codes.maxCodeLength = length;
+				currentCode++;
+			}
+		}
+		//more codes than fit into this length. the lengths can not be from a Huffman tree
+		if (currentCode > (1u << length))
+		{
+			return false;
+		}
+		currentCode <<= 1;
+	}
+	return codeIndex > 0;
+}
+
+/// @brief Build decoding tables from code lengths. Returns false if the lengths do not form a valid prefix code.
+/// single and table must have room for DecodeTableSize entries.
+static bool buildDecodeTables(const std::array<uint8_t, 256> & codeLengths, uint16_t * single, uint32_t * table, HuffmanDecodeTables & tables)
+{
+	if (!sortCanonicalCodes(codeLengths, tables))
+	{
+		return false;
+	}
+	//build a table of the symbol and length for every code of up to DecodeTableBits bits
+	const uint32_t tableSize = DecodeTableSize;
+	std::fill_n(single, tableSize, 0);
+	for (uint32_t length = 1; length <= DecodeTableBits; ++length)
+	{
+		for (uint32_t i = 0; i < tables.codeLengthCount[length]; ++i)
+		{
+			const uint32_t shift = DecodeTableBits - length;
+			const uint16_t entry = static_cast<uint16_t>((tables.symbols[tables.codeLengthStart[length] + i] << 4) | length);
+			std::fill_n(single + ((tables.firstCode[length] + i) << shift), 1 << shift, entry);
+		}
+	}
+	//combine as many codes as fit completely into the DecodeTableBits bits of every entry, but at most 3
+	for (uint32_t index = 0; index < tableSize; ++index)
+	{
+		uint32_t entry = 0;
+		uint32_t usedBits = 0;
+		uint32_t symbolCount = 0;
+		while (symbolCount < 3)
+		{
+			const uint16_t code = single[(index << usedBits) & (tableSize - 1)];
+			const uint32_t length = code & 15;
+			if (length == 0 || usedBits + length > DecodeTableBits)
+			{
+				break;
+			}
+			entry |= static_cast<uint32_t>(code >> 4) << (8 * symbolCount);
+			usedBits += length;
+			symbolCount++;
+		}
+		table[index] = entry | (usedBits << 24) | (symbolCount << 28);
+	}
+	tables.single = single;
+	tables.table = table;
+	return true;
+}
+
+/// @brief Decode a code longer than DecodeTableBits by checking every longer code length.
+/// The reader must hold at least 15 bits. Returns false if the code is invalid.
+static bool decodeLongCode(const HuffmanDecodeTables & tables, Tools::BitReader & reader, uint8_t & symbol)
+{
+	const uint32_t codeBits = reader.peek(15);
+	for (uint32_t length = DecodeTableBits + 1; length <= tables.maxCodeLength; ++length)
+	{
+		const uint32_t codeWord = codeBits >> (15 - length);
+		if (codeWord - tables.firstCode[length] < tables.codeLengthCount[length])
+		{
+			symbol = tables.symbols[tables.codeLengthStart[length] + codeWord - tables.firstCode[length]];
+			reader.skip(length);
+			return true;
+		}
+	}
+	return false;
+}
+
+/// @brief Decode up to 3 symbols with one table lookup. Always writes 3 bytes to out.
+/// The reader must hold at least 15 bits. Returns false if the code is invalid.
+static inline bool decodeSymbols(const HuffmanDecodeTables & tables, Tools::BitReader & reader, uint8_t *& out)
+{
+	const uint32_t entry = tables.table[reader.peek(DecodeTableBits)];
+	if (entry != 0)
+	{
+		out[0] = static_cast<uint8_t>(entry);
+		out[1] = static_cast<uint8_t>(entry >> 8);
+		out[2] = static_cast<uint8_t>(entry >> 16);
+		out += entry >> 28;
+		reader.skip((entry >> 24) & 15);
+		return true;
+	}
+	return decodeLongCode(tables, reader, *out++);
+}
+
+/// @brief Decode symbols from the reader until out reaches outEnd. Returns false if the data is invalid.
+static bool decodeStream(const HuffmanDecodeTables & tables, Tools::BitReader & reader, uint8_t * out, uint8_t * const outEnd)
+{
+	//a refill gives us at least 56 bits, which is enough for 3 lookups of at most 15 bits each.
+	//every lookup writes 3 symbols, even if the entry holds less, so we need room for 9 bytes
+	while (outEnd - out >= 9)
+	{
+		reader.refill();
+		if (!decodeSymbols(tables, reader, out) || !decodeSymbols(tables, reader, out) || !decodeSymbols(tables, reader, out) || reader.overrun())
+		{
+			return false;
+		}
+	}
+	//decode the remaining symbols one by one
+	while (out < outEnd)
+	{
+		reader.refill();
+		const uint32_t entry = tables.table[reader.peek(DecodeTableBits)];
+		if (entry != 0)
+		{
+			*out++ = static_cast<uint8_t>(entry);
+			reader.skip(tables.single[reader.peek(DecodeTableBits)] & 15);
+		}
+		else if (!decodeLongCode(tables, reader, *out++))
+		{
+			return false;
+		}
+	}
+	return !reader.overrun();
+}
+
+/// @brief Decode StreamCount streams in one loop, so the CPU can decode the streams independently of each other.
+/// When the first stream is close to the end of its part, every stream decodes its remaining symbols on its own.
+template <uint32_t StreamCount>
+static bool decodeStreams(const HuffmanDecodeTables & tables, const Tools::BitReader * streamReaders, uint8_t * const * streamOuts, uint8_t * const * outEnds)
+{
+	//work on local copies, so the compiler can keep them in registers although we write bytes to the output
+	Tools::BitReader readers[StreamCount];
+	uint8_t * outs[StreamCount];
+	for (uint32_t i = 0; i < StreamCount; ++i)
+	{
+		readers[i] = streamReaders[i];
+		outs[i] = streamOuts[i];
+	}
+	while (true)
+	{
+		bool room = true;
+		for (uint32_t i = 0; i < StreamCount; ++i)
+		{
+			room &= outEnds[i] - outs[i] >= 9;
+		}
+		if (!room)
+		{
+			break;
+		}
+		for (uint32_t i = 0; i < StreamCount; ++i)
+		{
+			readers[i].refill();
+		}
+		bool valid = true;
+		for (uint32_t lookup = 0; lookup < 3; ++lookup)
+		{
+			for (uint32_t i = 0; i < StreamCount; ++i)
+			{
+				valid &= decodeSymbols(tables, readers[i], outs[i]);
+			}
+		}
+		for (uint32_t i = 0; i < StreamCount; ++i)
+		{
+			valid &= !readers[i].overrun();
+		}
+		if (!valid)
+		{
+			return false;
+		}
+	}
+	for (uint32_t i = 0; i < StreamCount; ++i)
+	{
+		if (!decodeStream(tables, readers[i], outs[i], outEnds[i]))
+		{
+			return false;
 		}
-		return dest;
 	}
-	return std::vector<uint8_t>();
-}
\ No newline at end of file
+	return true;
+}
+
+/// @brief Decode data stored by encodeStreams() to dest. Returns false if the data is invalid.
+static bool decodeStreamData(const HuffmanDecodeTables & tables, const uint8_t * source, size_t size, uint32_t streamCount, uint8_t * dest, size_t destSize)
+{
+	if (streamCount == 1)
+	{
+		Tools::BitReader reader(source, size);
+		return decodeStream(tables, reader, dest, dest + destSize);
+	}
+	//read stream sizes. the last stream is the rest of the data
+	size_t srcIndex = 0;
+	uint64_t streamSizes[8];
+	for (uint32_t i = 0; i < streamCount - 1; ++i)
+	{
+		if (!Tools::readSize(source, size, srcIndex, streamSizes[i]))
+		{
+			return false;
+		}
+	}
+	Tools::BitReader readers[8];
+	uint8_t * outs[8];
+	uint8_t * outEnds[8];
+	const size_t partSize = destSize / streamCount;
+	for (uint32_t i = 0; i < streamCount; ++i)
+	{
+		const uint64_t streamSize = i < streamCount - 1 ? streamSizes[i] : size - srcIndex;
+		if (streamSize > size - srcIndex)
+		{
+			return false;
+		}
+		readers[i] = Tools::BitReader(source + srcIndex, static_cast<size_t>(streamSize));
+		srcIndex += static_cast<size_t>(streamSize);
+		outs[i] = dest + i * partSize;
+		outEnds[i] = i < streamCount - 1 ? outs[i] + partSize : dest + destSize;
+	}
+	return streamCount == 4 ? decodeStreams<4>(tables, readers, outs, outEnds) : decodeStreams<8>(tables, readers, outs, outEnds);
+}
+
+size_t StaticHuffman::decode4(const uint8_t * source, size_t size, uint8_t * dest, size_t destCapacity, Workspace & workspace) const
+{
+	const size_t srcSize = size;
+	//read result size
+	size_t srcIndex = 0;
+	uint64_t destSize = 0;
+	if (Tools::readSize(source, srcSize, srcIndex, destSize) && destSize <= destCapacity && srcIndex + 128 <= srcSize)
+	{
+		//read code lengths from data and build tables
+		uint8_t minCodeLength = 15;
+		uint8_t maxCodeLength = 0;
+		const CodeLengths codeLengths = getCodeLengthsFromHeader(source, srcIndex, minCodeLength, maxCodeLength);
+		HuffmanDecodeTables tables;
+		if (!buildDecodeTables(codeLengths, workspace.get<uint16_t>(0, DecodeTableSize), workspace.get<uint32_t>(1, DecodeTableSize), tables))
+		{
+			return 0;
+		}
+		Tools::BitReader reader(source + srcIndex, srcSize - srcIndex);
+		return decodeStream(tables, reader, dest, dest + destSize) ? static_cast<size_t>(destSize) : 0;
+	}
+	return 0;
+}
+
+size_t StaticHuffman::decodeInterleaved(const uint8_t * source, size_t size, uint8_t * dest, size_t destCapacity, Workspace & workspace) const
+{
+	const size_t srcSize = size;
+	//read result size and stream count
+	size_t srcIndex = 0;
+	uint64_t destSize = 0;
+	if (Tools::readSize(source, srcSize, srcIndex, destSize) && destSize <= destCapacity && srcIndex + 1 + 128 <= srcSize)
+	{
+		const uint32_t streamCount = source[srcIndex++];
+		if (streamCount != 4 && streamCount != 8)
+		{
+			return 0;
+		}
+		//read code lengths from data and build tables
+		uint8_t minCodeLength = 15;
+		uint8_t maxCodeLength = 0;
+		const CodeLengths codeLengths = getCodeLengthsFromHeader(source, srcIndex, minCodeLength, maxCodeLength);
+		HuffmanDecodeTables tables;
+		if (!buildDecodeTables(codeLengths, workspace.get<uint16_t>(0, DecodeTableSize), workspace.get<uint32_t>(1, DecodeTableSize), tables))
+		{
+			return 0;
+		}
+		return decodeStreamData(tables, source + srcIndex, srcSize - srcIndex, streamCount, dest, static_cast<size_t>(destSize)) ? static_cast<size_t>(destSize) : 0;
+	}
+	return 0;
+}
+
+/// @brief Read the code lengths written by writeUsedCodeLengths().
+static void readUsedCodeLengths(const uint8_t * source, size_t & index, std::array<uint8_t, 256> & lengths)
+{
+	const uint8_t * bitmap = source + index;
+	index += 32;
+	uint32_t nibbleCount = 0;
+	for (uint32_t i = 0; i < 256; ++i)
+	{
+		lengths[i] = 0;
+		if (bitmap[i / 8] & (0x80 >> (i & 7)))
+		{
+			lengths[i] = (nibbleCount++ & 1) == 0 ? source[index] >> 4 : source[index++] & 0x0F;
+		}
+	}
+	index += nibbleCount & 1;
+}
+
+/// @brief Position of a block of blocked data found by decodeBlocks().
+struct HuffmanBlock
+{
+	uint64_t tableBlock; /// @brief Index of the block that stores the code lengths for this block.
+	const uint8_t * table; /// @brief Code lengths of the block, if it stores them.
+	uint8_t tableMode; /// @brief 1 if table holds all code lengths, 2 if it holds only the used ones.
+	const uint8_t * data; /// @brief Compressed data of the block.
+	size_t dataSize; /// @brief Size of compressed data.
+};
+
+size_t StaticHuffman::decodeBlocks(const uint8_t * source, size_t size, uint8_t * dest, size_t destCapacity, Workspace & workspace) const
+{
+	const size_t srcSize = size;
+	//read result size, block size and stream count
+	size_t srcIndex = 0;
+	uint64_t destSize = 0;
+	uint64_t blockSize = 0;
+	if (Tools::readSize(source, srcSize, srcIndex, destSize) && destSize > 0 && destSize <= destCapacity &&
+		Tools::readSize(source, srcSize, srcIndex, blockSize) && blockSize >= MinBlockSize && blockSize <= MaxBlockSize && srcIndex < srcSize)
+	{
+		const uint32_t streamCount = source[srcIndex++];
+		if (streamCount != 1 && streamCount != 4 && streamCount != 8)
+		{
+			return 0;
+		}
+		//find the code lengths and data of all blocks, so they can be decoded in parallel
+		const uint64_t nrOfBlocks = (destSize + blockSize - 1) / blockSize;
+		HuffmanBlock * blocks = workspace.get<HuffmanBlock>(2, static_cast<size_t>(nrOfBlocks));
+		for (uint64_t blockIndex = 0; blockIndex < nrOfBlocks; ++blockIndex)
+		{
+			HuffmanBlock & block = blocks[blockIndex];
+			if (srcIndex >= srcSize)
+			{
+				return 0;
+			}
+			block.tableMode = source[srcIndex++];
+			block.table = source + srcIndex;
+			block.tableBlock = blockIndex;
+			if (block.tableMode == 0)
+			{
+				//use the code lengths of the previous block
+				if (blockIndex == 0)
+				{
+					return 0;
+				}
+				block.tableBlock = blocks[blockIndex - 1].tableBlock;
+			}
+			else if (block.tableMode == 1)
+			{
+				srcIndex += 128;
+			}
+			else if (block.tableMode == 2)
+			{
+				if (srcSize - srcIndex < 32)
+				{
+					return 0;
+				}
+				uint32_t usedCount = 0;
+				for (uint32_t i = 0; i < 256; ++i)
+				{
+					usedCount += (source[srcIndex + i / 8] >> (7 - (i & 7))) & 1;
+				}
+				srcIndex += 32 + (usedCount + 1) / 2;
+			}
+			else
+			{
+				return 0;
+			}
+			uint64_t dataSize = 0;
+			if (srcIndex > srcSize || !Tools::readSize(source, srcSize, srcIndex, dataSize) || dataSize > srcSize - srcIndex)
+			{
+				return 0;
+			}
+			block.data = source + srcIndex;
+			block.dataSize = static_cast<size_t>(dataSize);
+			srcIndex += block.dataSize;
+		}
+		//decode ranges of blocks on all threads. a thread only builds new tables when the code lengths change
+		const uint32_t nrOfThreads = Tools::parallelThreadCount(static_cast<uint32_t>(std::min<uint64_t>(threadCount(), nrOfBlocks)), threadCount());
+		if (m_verbose && nrOfThreads > 1) { std::cout << "Decoding " << nrOfBlocks << " Huffman block(s) using " << nrOfThreads << " thread(s)." << std::endl; }
+		uint16_t * singles = workspace.get<uint16_t>(0, nrOfThreads * DecodeTableSize);
+		uint32_t * tableEntries = workspace.get<uint32_t>(1, nrOfThreads * DecodeTableSize);
+		std::atomic<bool> valid(true);
+		Tools::parallelFor(nrOfThreads, nrOfThreads, [&](uint32_t item, uint32_t /*threadIndex*/)
+		{
+			HuffmanDecodeTables tables;
+			uint64_t tableBlock = UINT64_MAX;
+			const uint64_t firstBlock = nrOfBlocks * item / nrOfThreads;
+			const uint64_t endBlock = nrOfBlocks * (item + 1) / nrOfThreads;
+			for (uint64_t blockIndex = firstBlock; blockIndex < endBlock && valid; ++blockIndex)
+			{
+				const HuffmanBlock & block = blocks[blockIndex];
+				if (block.tableBlock != tableBlock)
+				{
+					tableBlock = block.tableBlock;
+					const HuffmanBlock & lengthsBlock = blocks[tableBlock];
+					size_t index = 0;
+					CodeLengths codeLengths;
+					if (lengthsBlock.tableMode == 1)
+					{
+						uint8_t minCodeLength = 15;
+						uint8_t maxCodeLength = 0;
+						codeLengths = getCodeLengthsFromHeader(lengthsBlock.table, index, minCodeLength, maxCodeLength);
+					}
+					else
+					{
+						readUsedCodeLengths(lengthsBlock.table, index, codeLengths);
+					}
+					if (!buildDecodeTables(codeLengths, singles + item * DecodeTableSize, tableEntries + item * DecodeTableSize, tables))
+					{
+						valid = false;
+						break;
+					}
+				}
+				const size_t blockStart = static_cast<size_t>(blockIndex * blockSize);
+				const size_t blockEnd = static_cast<size_t>(std::min(destSize, blockStart + blockSize));
+				if (!decodeStreamData(tables, block.data, block.dataSize, streamCount, dest + blockStart, blockEnd - blockStart))
+				{
+					valid = false;
+				}
+			}
+		});
+		return valid ? static_cast<size_t>(destSize) : 0;
+	}
+	return 0;
+}
+
+//------------------------------------------------------------------------------------------------
+
+/// @brief Incremental static Huffman decoder. Collects the header, then decodes canonical codes bit by bit,
+/// so code words may span multiple chunks of input.
+class StaticHuffmanDecodeStream : public I_CodecStream
+{
+public:
+	virtual bool push(const uint8_t * data, size_t size, std::vector<uint8_t> & output) override
+	{
+		size_t srcIndex = 0;
+		//collect header bytes until we have the size and the code lengths
+		while (!m_headerRead && srcIndex < size)
+		{
+			m_header.push_back(data[srcIndex++]);
+			size_t index = 0;
+			uint64_t destSize = 0;
+			if (Tools::readSize(m_header.data(), m_header.size(), index, destSize) && index + 128 <= m_header.size())
+			{
+				m_destSize = destSize;
+				if (!buildTables(&m_header[index]))
+				{
+					return false;
+				}
+				m_headerRead = true;
+				m_header.clear();
+			}
+		}
+		//decode data
+		while (srcIndex < size && m_destIndex < m_destSize)
+		{
+			const uint8_t byte = data[srcIndex++];
+			for (int32_t bit = 7; bit >= 0 && m_destIndex < m_destSize; --bit)
+			{
+				//add bit to current code word and check if it is a valid code of the current length
+				m_code = (m_code << 1) | ((byte >> bit) & 1);
+				m_codeLength++;
+				if (m_codeLength > 15)
+				{
+					return false;
+				}
+				const uint32_t codeIndex = m_code - m_codes.firstCode[m_codeLength];
+				if (codeIndex < m_codes.codeLengthCount[m_codeLength])
+				{
+					output.push_back(m_codes.symbols[m_codes.codeLengthStart[m_codeLength] + codeIndex]);
+					m_destIndex++;
+					m_code = 0;
+					m_codeLength = 0;
+				}
+			}
+		}
+		return true;
+	}
+
+	virtual bool finish(std::vector<uint8_t> & /*output*/) override
+	{
+		//no input at all is fine, as encode() produces no output for empty data
+		if (!m_headerRead)
+		{
+			return m_header.empty();
+		}
+		return m_destIndex == m_destSize;
+	}
+
+private:
+	/// @brief Build canonical code tables from the 128 bytes of code length nibbles.
+	/// Returns false if the lengths do not form a valid prefix code.
+	bool buildTables(const uint8_t * lengths)
+	{
+		std::array<uint8_t, 256> codeLengths;
+		for (uint32_t i = 0; i < 128; ++i)
+		{
+			codeLengths[2 * i] = lengths[i] >> 4;
+			codeLengths[2 * i + 1] = lengths[i] & 0x0F;
+		}
+		return sortCanonicalCodes(codeLengths, m_codes);
+	}
+
+	std::vector<uint8_t> m_header;
+	bool m_headerRead = false;
+	uint64_t m_destSize = 0;
+	uint64_t m_destIndex = 0;
+	HuffmanCanonicalCodes m_codes;
+	uint32_t m_code = 0;
+	uint32_t m_codeLength = 0;
+};
+
+I_CodecStream::SPtr StaticHuffman::createDecodeStream() const
+{
+	//streams of interleaved or blocked data can only be decoded when all data is there
+	if (m_streamCount > 1 || m_blockSize > 0)
+	{
+		return I_Codec::createDecodeStream();
+	}
+	return std::make_shared<StaticHuffmanDecodeStream>();
+}
@@ -20,8 +20,7 @@ bool sortByLengthFirstThenSymbolAscending(const HuffmanCode & a, const HuffmanCo
 
 HuffmanCodes convertToCanonicalCodes(const HuffmanCodes & codes)
 {
-	HuffmanCodes canonical(256);
-	std::copy(codes.cbegin(), codes.cend(), canonical.begin());
+	HuffmanCodes canonical(codes);
 	//sort codes by length first, then by alphabet value
 	std::sort(canonical.begin(), canonical.end(), sortByLengthFirstThenSymbolAscending);
 	//now replace the codes, keeping the length
@@ -46,4 +45,116 @@ HuffmanCodes convertToCanonicalCodes(const HuffmanCodes & codes)
 		++iter;
 	}
 	return canonical;
-}
\ No newline at end of file
+}
+
+bool sortBySymbolAscending(const HuffmanCode & a, const HuffmanCode & b)
+{
+	return a.symbol < b.symbol;
+}
+
+void buildCodeLengths(const uint32_t * frequencies, uint32_t symbolCount, uint8_t allowedCodeLength, uint8_t * lengths)
+{
+	//sort used symbols by frequency, then by symbol. the frequency goes into the upper bits, the symbol into the lower bits
+	uint64_t leaves[MaxHuffmanSymbols];
+	uint32_t leafCount = 0;
+	for (uint32_t i = 0; i < symbolCount; ++i)
+	{
+		lengths[i] = 0;
+		if (frequencies[i] > 0)
+		{
+			leaves[leafCount++] = (static_cast<uint64_t>(frequencies[i]) << 16) | i;
+		}
+	}
+	if (leafCount == 0)
+	{
+		return;
+	}
+	if (leafCount == 1)
+	{
+		//a single symbol still needs a code of one bit
+		lengths[leaves[0] & 0xFFFF] = 1;
+		return;
+	}
+	std::sort(leaves, leaves + leafCount);
+	//we need at least log2(leafCount) bits for all symbols
+	uint32_t maxLength = std::min(allowedCodeLength, MaxHuffmanCodeLength);
+	while ((1u << maxLength) < leafCount)
+	{
+		maxLength++;
+	}
+	//package-merge: start with the leaves at the deepest level. every level above holds the leaves merged with
+	//pairs of items ("packages") of the level below. we only need the first 2 * leafCount - 2 items of every level.
+	//isPackage remembers for every level which items are packages, the weights are only needed for the last level.
+	const uint32_t itemCount = 2 * leafCount - 2;
+	uint64_t weights[2][2 * MaxHuffmanSymbols];
+	uint8_t isPackage[MaxHuffmanCodeLength][2 * MaxHuffmanSymbols];
+	uint32_t levelSize = leafCount;
+	for (uint32_t i = 0; i < leafCount; ++i)
+	{
+		weights[0][i] = leaves[i] >> 16;
+		isPackage[0][i] = 0;
+	}
+	for (uint32_t level = 1; level < maxLength; ++level)
+	{
+		const uint64_t * below = weights[(level - 1) & 1];
+		uint64_t * current = weights[level & 1];
+		const uint32_t packageCount = levelSize / 2;
+		const uint32_t size = std::min(leafCount + packageCount, itemCount);
+		uint32_t leaf = 0;
+		uint32_t package = 0;
+		for (uint32_t i = 0; i < size; ++i)
+		{
+			//take the lighter of the next leaf and package. prefer leaves, so codes get as short as possible
+			const uint64_t packageWeight = package < packageCount ? below[2 * package] + below[2 * package + 1] : UINT64_MAX;
+			if (leaf < leafCount && (leaves[leaf] >> 16) <= packageWeight)
+			{
+				current[i] = leaves[leaf++] >> 16;
+				isPackage[level][i] = 0;
+			}
+			else
+			{
+				current[i] = packageWeight;
+				isPackage[level][i] = 1;
+				package++;
+			}
+		}
+		levelSize = size;
+	}
+	//take the first items of the top level. every leaf in them adds one bit to the code length of its symbol and
+	//every package takes two items of the level below. the leaves taken from a level are always the lightest ones
+	uint32_t count = itemCount;
+	for (uint32_t level = maxLength; level-- > 0 && count > 0;)
+	{
+		uint32_t leafTaken = 0;
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			leafTaken += isPackage[level][i] ^ 1;
+		}
+		for (uint32_t i = 0; i < leafTaken; ++i)
+		{
+			lengths[leaves[i] & 0xFFFF]++;
+		}
+		count = 2 * (count - leafTaken);
+	}
+}
+
+HuffmanCodes buildCanonicalCodes(const uint32_t * frequencies, uint32_t symbolCount, uint8_t allowedCodeLength)
+{
+	uint8_t lengths[MaxHuffmanSymbols];
+	buildCodeLengths(frequencies, symbolCount, allowedCodeLength, lengths);
+	return canonicalCodesFromLengths(lengths, symbolCount);
+}
+
+HuffmanCodes canonicalCodesFromLengths(const uint8_t * lengths, uint32_t symbolCount)
+{
+	HuffmanCodes codes(symbolCount);
+	for (uint32_t i = 0; i < symbolCount; ++i)
+	{
+		codes[i].symbol = static_cast<uint16_t>(i);
+		codes[i].code = 0;
+		codes[i].length = lengths[i] > 0 ? lengths[i] : 255;
+	}
+	codes = convertToCanonicalCodes(codes);
+	std::sort(codes.begin(), codes.end(), sortBySymbolAscending);
+	return codes;
+}
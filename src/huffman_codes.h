@@ -7,7 +7,7 @@
 /// @brief Huffman code structure.
 struct HuffmanCode
 {
-	uint8_t symbol;
+	uint16_t symbol;
 	uint32_t code;
 	uint8_t length;
 };
@@ -28,6 +28,35 @@ bool operator==(const HuffmanCode & a, const HuffmanCode & b);
 bool operator!=(const HuffmanCode & a, const HuffmanCode & b);
 
 /// @brief Covert Huffman codes to canonical codes.
-/// @param codes Huffman codes to convert.
-/// @return Returns the codes converted to canonical form.
+/// @param codes Huffman codes to convert. Unused symbols must have a length of 255. Can have any number of symbols.
+/// @return Returns the codes converted to canonical form, sorted by code length first, then by symbol.
 HuffmanCodes convertToCanonicalCodes(const HuffmanCodes & codes);
+
+/// @brief Maximum number of symbols buildCodeLengths() and buildCanonicalCodes() can handle.
+const uint32_t MaxHuffmanSymbols = 512;
+
+/// @brief Maximum code length buildCodeLengths() and buildCanonicalCodes() can produce.
+const uint8_t MaxHuffmanCodeLength = 16;
+
+/// @brief Build optimal code lengths limited to allowedCodeLength from symbol frequencies using the package-merge algorithm
+/// (see: https://en.wikipedia.org/wiki/Package-merge_algorithm). Does not allocate memory.
+/// Symbols with a frequency of 0 get no code. A single used symbol gets a code length of 1.
+/// @param frequencies Frequencies of symbols.
+/// @param symbolCount Number of symbols in the alphabet. Must be <= MaxHuffmanSymbols.
+/// @param allowedCodeLength Maximum length of Huffman codes allowed. Clamped to [log2(used symbols), MaxHuffmanCodeLength].
+/// @param lengths Code lengths of symbols. 0 for unused symbols. Must have room for symbolCount entries.
+void buildCodeLengths(const uint32_t * frequencies, uint32_t symbolCount, uint8_t allowedCodeLength, uint8_t * lengths);
+
+/// @brief Build canonical Huffman codes for an alphabet of any size from symbol frequencies.
+/// Symbols with a frequency of 0 get no code. The code lengths are built with buildCodeLengths().
+/// @param frequencies Frequencies of symbols.
+/// @param symbolCount Number of symbols in the alphabet. Must be <= MaxHuffmanSymbols.
+/// @param allowedCodeLength Maximum length of Huffman codes allowed.
+/// @return Returns the canonical codes sorted by symbol. Unused symbols have a code length of 0.
+HuffmanCodes buildCanonicalCodes(const uint32_t * frequencies, uint32_t symbolCount, uint8_t allowedCodeLength);
+
+/// @brief Reconstruct canonical Huffman codes from code lengths, e.g. read from a header.
+/// @param lengths Code lengths of symbols. 0 for unused symbols.
+/// @param symbolCount Number of symbols in the alphabet.
+/// @return Returns the canonical codes sorted by symbol. Unused symbols have a code length of 0.
+HuffmanCodes canonicalCodesFromLengths(const uint8_t * lengths, uint32_t symbolCount);
@@ -0,0 +1,216 @@
+#include "lz4_codec.h"
+
+#include "lz_matchfinder.h"
+#include "tools.h"
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+
+const uint8_t LZ4::CodecIdentifier = 75;
+const uint32_t LZ4::MinLevel = 1;
+const uint32_t LZ4::MaxLevel = 9;
+const uint32_t LZ4::DefaultLevel = 1;
+
+/// @brief Minimum length of a match.
+static const uint32_t MinMatchLength = 4;
+/// @brief Number of bytes at the end of the data that are always literals.
+static const int64_t LastLiterals = 5;
+/// @brief A match must start at least this many bytes before the end of the data.
+static const int64_t MatchStartLimit = 12;
+/// @brief Maximum distance of a match.
+static const int64_t MaxOffset = 65535;
+/// @brief Number of bits of the match finder hash.
+static const uint32_t HashBits = 16;
+
+uint8_t LZ4::codecIdentifier() const
+{
+	return CodecIdentifier;
+}
+
+std::string LZ4::codecName() const
+{
+	return "LZ4";
+}
+
+LZ4 * LZ4::Create()
+{
+	return new LZ4();
+}
+
+void LZ4::setCompressionParameters(const uint32_t level)
+{
+	m_level = std::min(std::max(level, MinLevel), MaxLevel);
+}
+
+void LZ4::outputSequence(const uint8_t * literals, size_t literalCount, uint32_t offset, size_t matchLength, uint8_t * dest, size_t & destIndex)
+{
+	//store literal count and match length in token. 15 means more bytes follow
+	const size_t matchCount = matchLength > 0 ? matchLength - MinMatchLength : 0;
+	uint8_t & token = dest[destIndex++];
+	token = static_cast<uint8_t>((std::min<size_t>(literalCount, 15) << 4) | std::min<size_t>(matchCount, 15));
+	if (literalCount >= 15)
+	{
+		size_t remaining = literalCount - 15;
+		for (; remaining >= 255; remaining -= 255)
+		{
+			dest[destIndex++] = 255;
+		}
+		dest[destIndex++] = static_cast<uint8_t>(remaining);
+	}
+	std::memcpy(dest + destIndex, literals, literalCount);
+	destIndex += literalCount;
+	//the last sequence has no match
+	if (matchLength > 0)
+	{
+		dest[destIndex++] = static_cast<uint8_t>(offset);
+		dest[destIndex++] = static_cast<uint8_t>(offset >> 8);
+		if (matchCount >= 15)
+		{
+			size_t remaining = matchCount - 15;
+			for (; remaining >= 255; remaining -= 255)
+			{
+				dest[destIndex++] = 255;
+			}
+			dest[destIndex++] = static_cast<uint8_t>(remaining);
+		}
+	}
+}
+
+size_t LZ4::encodeBound(size_t size) const
+{
+	//size + literal data + 1 length byte for every 255 literals + tokens and length of the last sequence
+	return Tools::MaxSizeBytes + size + size / 255 + 16;
+}
+
+size_t LZ4::encodeInto(const uint8_t * source, size_t size, uint8_t * dest, size_t destSize, Workspace & workspace) const
+{
+	const int64_t srcSize = static_cast<int64_t>(size);
+	if (srcSize > 0 && destSize >= encodeBound(size))
+	{
+		size_t destIndex = 0;
+		//output source size
+		Tools::writeSize(dest, destIndex, srcSize);
+		//find matches and output every match with the literals before it
+		int64_t anchor = 0;
+		if (srcSize > MatchStartLimit)
+		{
+			LZMatchFinder matchFinder(workspace.get<int64_t>(0, size_t(1) << HashBits), HashBits, workspace.get<int64_t>(1, MaxOffset + 1), MaxOffset + 1, MinMatchLength, 1U << (m_level - 1));
+			const int64_t matchEndLimit = srcSize - LastLiterals;
+			int64_t position = 0;
+			while (position <= srcSize - MatchStartLimit)
+			{
+				matchFinder.insert(source, 0, position, srcSize);
+				int64_t matchPosition = 0;
+				const int32_t maxLength = static_cast<int32_t>(std::min<int64_t>(matchEndLimit - position, std::numeric_limits<int32_t>::max()));
+				int32_t matchLength = matchFinder.find(source, 0, position, std::max<int64_t>(0, position - MaxOffset), maxLength, matchPosition, true);
+				if (matchLength < static_cast<int32_t>(MinMatchLength))
+				{
+					++position;
+					continue;
+				}
+				//extend match backwards into the literals
+				while (position > anchor && matchPosition > 0 && source[position - 1] == source[matchPosition - 1])
+				{
+					--position;
+					--matchPosition;
+					++matchLength;
+				}
+				outputSequence(source + anchor, static_cast<size_t>(position - anchor), static_cast<uint32_t>(position - matchPosition), matchLength, dest, destIndex);
+				position += matchLength;
+				anchor = position;
+			}
+		}
+		//output remaining literals
+		outputSequence(source + anchor, static_cast<size_t>(srcSize - anchor), 0, 0, dest, destIndex);
+		return destIndex;
+	}
+	return 0;
+}
+
+size_t LZ4::decodedSize(const uint8_t * source, size_t size) const
+{
+	size_t srcIndex = 0;
+	uint64_t destSize = 0;
+	return Tools::readSize(source, size, srcIndex, destSize) ? static_cast<size_t>(destSize) : 0;
+}
+
+/// @brief Add extra length bytes to length until a byte is not 255.
+static bool readLength(const uint8_t * & in, const uint8_t * inEnd, size_t & length)
+{
+	uint8_t value = 0;
+	do
+	{
+		if (in >= inEnd)
+		{
+			return false;
+		}
+		value = *in++;
+		length += value;
+	} while (value == 255);
+	return true;
+}
+
+size_t LZ4::decodeInto(const uint8_t * source, size_t size, uint8_t * dest, size_t destCapacity, Workspace & /*workspace*/) const
+{
+	// read result size
+	size_t srcIndex = 0;
+	uint64_t destSize = 0;
+	if (Tools::readSize(source, size, srcIndex, destSize) && destSize > 0 && destSize <= destCapacity)
+	{
+		const uint8_t * in = source + srcIndex;
+		const uint8_t * inEnd = source + size;
+		uint8_t * out = dest;
+		uint8_t * outEnd = dest + destSize;
+		while (in < inEnd)
+		{
+			const uint8_t token = *in++;
+			// read literal count
+			size_t literalCount = token >> 4;
+			if (literalCount == 15 && !readLength(in, inEnd, literalCount))
+			{
+				return 0;
+			}
+			if (literalCount > static_cast<size_t>(inEnd - in) || literalCount > static_cast<size_t>(outEnd - out))
+			{
+				return 0;
+			}
+			// copy short literals with one 16-byte copy if there is enough room
+			if (literalCount <= 16 && inEnd - in >= 16 && outEnd - out >= 16)
+			{
+				std::memcpy(out, in, 16);
+			}
+			else
+			{
+				std::memcpy(out, in, literalCount);
+			}
+			out += literalCount;
+			in += literalCount;
+			// the last sequence only has literals
+			if (in == inEnd)
+			{
+				break;
+			}
+			// read match offset and length
+			if (inEnd - in < 2)
+			{
+				return 0;
+			}
+			const size_t offset = in[0] | (static_cast<size_t>(in[1]) << 8);
+			in += 2;
+			size_t matchLength = token & 15;
+			if (matchLength == 15 && !readLength(in, inEnd, matchLength))
+			{
+				return 0;
+			}
+			matchLength += MinMatchLength;
+			if (offset == 0 || offset > static_cast<size_t>(out - dest) || matchLength > static_cast<size_t>(outEnd - out))
+			{
+				return 0;
+			}
+			out = Tools::copyMatch(out, offset, matchLength, outEnd);
+		}
+		return out == outEnd ? static_cast<size_t>(destSize) : 0;
+	}
+	return 0;
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "codec.h"
+#include <inttypes.h>
+
+
+class LZ4 : public I_Codec
+{
+public:
+	/// @brief Codec identifier. Do not change this and make sure there are no duplicate identifiers!
+	static const uint8_t CodecIdentifier;
+
+	/// @brief Lowest compression level. Fastest, checking a single match candidate.
+	static const uint32_t MinLevel;
+	/// @brief Highest compression level. Slowest, checking many match candidates.
+	static const uint32_t MaxLevel;
+	/// @brief Compression level used if none is set.
+	static const uint32_t DefaultLevel;
+
+	/// @brief Typedef for sharing a codec. Used in Compressor::compress().
+	typedef std::shared_ptr<LZ4> SPtr;
+
+	/// @brief Create a new codec instance.
+	/// @return Return codec instance.
+	static LZ4 * Create();
+
+	/// @brief Codec identifier.
+	/// @return Codec identifier.
+	virtual uint8_t codecIdentifier() const override;
+
+	/// @brief Codec (human-readable) name.
+	/// @return Codec name.
+	virtual std::string codecName() const override;
+
+	/// @brief Set the compression level. Level n checks up to 2^(n-1) match candidates per position.
+	/// The level only changes how hard the encoder searches. All levels decode at the same speed.
+	/// @param level Compression level [MinLevel,MaxLevel].
+	void setCompressionParameters(const uint32_t level = 1);
+
+	/// @brief Worst-case size of the data encodeInto() produces with the current settings.
+	/// @param size Size of source data.
+	/// @return Returns the size of header data plus size, 1 byte for every 255 literals and a final token.
+	virtual size_t encodeBound(size_t size) const override;
+
+	/// @brief Apply byte-aligned LZ encoding using the LZ4 block format.
+	/// The data is a sequence of tokens. The upper nibble of a token is the number of literals, the lower nibble
+	/// the match length minus 4. A nibble of 15 is followed by extra bytes that are added until a byte is not 255.
+	/// Then follow the literals, the match offset (2 bytes, 1-65535) and the extra match length bytes.
+	/// The last token only has literals. The last match ends at least 5 bytes and starts at least 12 bytes
+	/// before the end of the data, so the decoder can copy in big chunks.
+	/// @param source Pointer to source data.
+	/// @param size Size of source data.
+	/// @param dest Pointer to destination buffer.
+	/// @param destSize Size of destination buffer. Must be at least encodeBound(size).
+	/// @param workspace Scratch memory reused across calls.
+	/// @return Number of bytes written to dest. 0 if encoding failed.
+	virtual size_t encodeInto(const uint8_t * source, size_t size, uint8_t * dest, size_t destSize, Workspace & workspace) const override;
+
+	/// @brief Size of the data decodeInto() produces.
+	/// @param source Pointer to compressed data.
+	/// @param size Size of compressed data.
+	/// @return Returns the size stored in the header of the compressed data. 0 if the size could not be determined.
+	virtual size_t decodedSize(const uint8_t * source, size_t size) const override;
+
+	/// @brief Apply reverse byte-aligned LZ encoding.
+	/// Literals and matches are copied in 8/16-byte chunks that may write past their end while they are far
+	/// enough from the end of dest. Close to the end, bytes are copied one by one.
+	/// @param source Pointer to compressed data.
+	/// @param size Size of compressed data.
+	/// @param dest Pointer to destination buffer.
+	/// @param destSize Size of destination buffer. Must be at least decodedSize(source, size).
+	/// @param workspace Scratch memory reused across calls.
+	/// @return Number of bytes written to dest. 0 if decoding failed.
+	virtual size_t decodeInto(const uint8_t * source, size_t size, uint8_t * dest, size_t destSize, Workspace & workspace) const override;
+
+private:
+	/// @brief Output a sequence of literals and a match to dest. Pass a matchLength of 0 for the last sequence with literals only.
+	static void outputSequence(const uint8_t * literals, size_t literalCount, uint32_t offset, size_t matchLength, uint8_t * dest, size_t & destIndex);
+
+	/// @brief Compression level.
+	uint32_t m_level = 1;
+};
@@ -0,0 +1,132 @@
+#include "lz_dictionary.h"
+
+#include <algorithm>
+
+
+/// @brief Length of the strings counted in the samples. About the minimum match length of the LZ codecs.
+static const size_t StringLength = 6;
+/// @brief Length of the segments the dictionary is built from.
+static const size_t SegmentLength = 512;
+/// @brief Number of bits of the string hash.
+static const uint32_t HashBits = 20;
+
+static uint32_t stringHash(const uint8_t * data)
+{
+	uint64_t value = 0;
+	for (size_t i = 0; i < StringLength; ++i)
+	{
+		value = (value << 8) | data[i];
+	}
+	return static_cast<uint32_t>((value * 0x9E3779B97F4A7C15ULL) >> (64 - HashBits));
+}
+
+std::vector<uint8_t> trainLZDictionary(const std::vector<std::vector<uint8_t>> & samples, size_t dictionarySize)
+{
+	//count in how many samples every string appears
+	std::vector<uint32_t> sampleCounts(size_t(1) << HashBits, 0);
+	std::vector<uint32_t> lastSample(size_t(1) << HashBits, UINT32_MAX);
+	size_t stringCount = 0;
+	for (uint32_t sampleIndex = 0; sampleIndex < samples.size(); ++sampleIndex)
+	{
+		const std::vector<uint8_t> & sample = samples[sampleIndex];
+		for (size_t position = 0; position + StringLength <= sample.size(); ++position)
+		{
+			const uint32_t hash = stringHash(sample.data() + position);
+			if (lastSample[hash] != sampleIndex)
+			{
+				lastSample[hash] = sampleIndex;
+				sampleCounts[hash]++;
+			}
+		}
+		stringCount += sample.size() >= StringLength ? sample.size() - StringLength + 1 : 0;
+	}
+	//a string found in a single sample does not help
+	const auto stringScore = [&sampleCounts](uint32_t hash) { return sampleCounts[hash] > 1 ? sampleCounts[hash] : 0; };
+	//split the positions of all samples into one range per segment. the best segment of every range goes into the dictionary
+	struct Segment
+	{
+		uint32_t sampleIndex;
+		size_t position;
+		size_t length;
+		uint64_t score;
+	};
+	std::vector<Segment> segments;
+	const size_t rangeSize = std::max(SegmentLength, stringCount / std::max<size_t>(1, dictionarySize / SegmentLength));
+	//number of times a string appears in the current segment. its score only counts once
+	std::vector<uint16_t> segmentCounts(size_t(1) << HashBits, 0);
+	Segment best = { 0, 0, 0, 0 };
+	size_t rangeStart = 0;
+	size_t rangeEnd = rangeSize;
+	const auto takeBest = [&]()
+	{
+		if (best.score > 0)
+		{
+			segments.push_back(best);
+			//strings in the dictionary do not count for the next segments anymore
+			const uint8_t * data = samples[best.sampleIndex].data() + best.position;
+			for (size_t i = 0; i + StringLength <= best.length; ++i)
+			{
+				sampleCounts[stringHash(data + i)] = 0;
+			}
+		}
+		best.score = 0;
+	};
+	for (uint32_t sampleIndex = 0; sampleIndex < samples.size(); ++sampleIndex)
+	{
+		const std::vector<uint8_t> & sample = samples[sampleIndex];
+		const size_t sampleStrings = sample.size() >= StringLength ? sample.size() - StringLength + 1 : 0;
+		size_t start = 0;
+		while (start < sampleStrings)
+		{
+			//check all segments starting in the part of the sample that lies in the current range
+			const size_t end = std::min(sampleStrings, start + (rangeEnd - rangeStart));
+			const size_t segmentStrings = SegmentLength - StringLength + 1;
+			uint64_t score = 0;
+			size_t windowEnd = start;
+			for (size_t position = start; position < end; ++position)
+			{
+				//slide the window of strings of the segment at position
+				for (; windowEnd < std::min(position + segmentStrings, sampleStrings); ++windowEnd)
+				{
+					const uint32_t hash = stringHash(sample.data() + windowEnd);
+					score += segmentCounts[hash]++ == 0 ? stringScore(hash) : 0;
+				}
+				if (score > best.score)
+				{
+					best = { sampleIndex, position, std::min(SegmentLength, sample.size() - position), score };
+				}
+				const uint32_t hash = stringHash(sample.data() + position);
+				score -= --segmentCounts[hash] == 0 ? stringScore(hash) : 0;
+			}
+			//remove the strings left in the window
+			for (size_t position = end; position < windowEnd; ++position)
+			{
+				segmentCounts[stringHash(sample.data() + position)]--;
+			}
+			rangeStart += end - start;
+			start = end;
+			if (rangeStart == rangeEnd)
+			{
+				takeBest();
+				rangeEnd += rangeSize;
+			}
+		}
+	}
+	takeBest();
+	//store the best segments last. if there are too many, leave out the worst ones
+	std::stable_sort(segments.begin(), segments.end(), [](const Segment & a, const Segment & b) { return a.score < b.score; });
+	std::vector<uint8_t> dictionary;
+	size_t dictionaryLength = 0;
+	auto firstSegment = segments.cend();
+	while (firstSegment != segments.cbegin() && dictionaryLength + std::prev(firstSegment)->length <= dictionarySize)
+	{
+		--firstSegment;
+		dictionaryLength += firstSegment->length;
+	}
+	for (auto segment = firstSegment; segment != segments.cend(); ++segment)
+	{
+		const uint8_t * data = samples[segment->sampleIndex].data() + segment->position;
+		dictionary.insert(dictionary.end(), data, data + segment->length);
+	}
+	return dictionary;
+}
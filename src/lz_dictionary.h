@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstddef>
+#include <inttypes.h>
+#include <vector>
+
+
+/// @brief Build a dictionary for LZ codecs (see I_Codec::setDictionary()) from sample data, e.g. typical small messages.
+/// The samples are split into as many ranges as the dictionary has segments. From every range the segment is taken
+/// whose short strings appear in the most samples. Strings already in the dictionary do not count for later segments.
+/// The most useful segments are stored last, because codecs use the end of the dictionary if it is bigger than their window.
+/// @param samples Sample data. Use many samples, as a string only counts once per sample.
+/// @param dictionarySize Maximum size of the dictionary in bytes.
+/// @return Returns the dictionary. Empty if the samples have no strings in common.
+std::vector<uint8_t> trainLZDictionary(const std::vector<std::vector<uint8_t>> & samples, size_t dictionarySize);
@@ -0,0 +1,207 @@
+#include "lz_matchfinder.h"
+
+#include "tools.h"
+#include <algorithm>
+#include <cstring>
+
+#if defined(__AVX2__)
+	#include <immintrin.h>
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define LZ_MATCHFINDER_SSE2 1
+	#include <emmintrin.h>
+#endif
+#if !defined(__BYTE_ORDER__) || __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+	#define LZ_MATCHFINDER_LITTLE_ENDIAN 1
+#endif
+
+
+const uint32_t LZMatchFinder::MinHashLength = 2;
+const uint32_t LZMatchFinder::MaxHashLength = 4;
+const uint32_t LZMatchFinder::LongHashLength = 8;
+
+LZMatchFinder::LZMatchFinder(int64_t * head, uint32_t hashBits, int64_t * chain, uint32_t chainSize, uint32_t hashLength, uint32_t maxChainLength)
+	: m_head(head), m_hashBits(hashBits), m_chain(chain), m_chainSize(chainSize)
+	, m_hashLength(std::min(std::max(hashLength, MinHashLength), MaxHashLength)), m_maxChainLength(std::max(maxChainLength, 1U))
+{
+	reset();
+}
+
+void LZMatchFinder::setLongRangeTable(int64_t * table, uint32_t tableBits, uint32_t sampleBits)
+{
+	m_longTable = table;
+	m_longTableBits = tableBits;
+	m_longSampleBits = std::min(sampleBits, 64 - tableBits);
+	std::fill_n(m_longTable, static_cast<size_t>(1) << m_longTableBits, -1);
+}
+
+void LZMatchFinder::reset(int64_t position)
+{
+	std::fill_n(m_head, static_cast<size_t>(1) << m_hashBits, -1);
+	if (m_longTable != nullptr)
+	{
+		std::fill_n(m_longTable, static_cast<size_t>(1) << m_longTableBits, -1);
+	}
+	m_nextPosition = position;
+}
+
+uint32_t LZMatchFinder::hash(const uint8_t * data) const
+{
+	uint32_t value = data[0] | (static_cast<uint32_t>(data[1]) << 8);
+	if (m_hashLength > 2)
+	{
+		value |= static_cast<uint32_t>(data[2]) << 16;
+	}
+	if (m_hashLength > 3)
+	{
+		value |= static_cast<uint32_t>(data[3]) << 24;
+	}
+	//multiplicative hashing. the top bits are the best mixed
+	return (value * 2654435761U) >> (32 - m_hashBits);
+}
+
+int64_t LZMatchFinder::longHash(const uint8_t * data) const
+{
+	uint64_t value;
+	std::memcpy(&value, data, 8);
+	//the top bits are the table index. the bits below them decide if the position is stored
+	const uint64_t product = value * 0x9E3779B97F4A7C15ULL;
+	if (m_longSampleBits > 0 && ((product << m_longTableBits) >> (64 - m_longSampleBits)) != 0)
+	{
+		return -1;
+	}
+	return static_cast<int64_t>(product >> (64 - m_longTableBits));
+}
+
+void LZMatchFinder::insert(const uint8_t * data, int64_t base, int64_t position, int64_t end)
+{
+	while (m_nextPosition < position && m_nextPosition + m_hashLength <= end)
+	{
+		int64_t & head = m_head[hash(data + (m_nextPosition - base))];
+		//link to the previous position with the same hash. the chain entry of a position is reused chainSize positions later
+		m_chain[static_cast<uint32_t>(m_nextPosition) & (m_chainSize - 1)] = head;
+		head = m_nextPosition;
+		//the long-range table only keeps the last position of every hash
+		if (m_longTable != nullptr && m_nextPosition + LongHashLength <= end)
+		{
+			const int64_t index = longHash(data + (m_nextPosition - base));
+			if (index >= 0)
+			{
+				m_longTable[index] = m_nextPosition;
+			}
+		}
+		++m_nextPosition;
+	}
+}
+
+int32_t LZMatchFinder::find(const uint8_t * data, int64_t base, int64_t position, int64_t windowStart, int32_t maxLength, int64_t & matchPosition, bool overlap) const
+{
+	if (maxLength < static_cast<int32_t>(m_hashLength))
+	{
+		return 0;
+	}
+	const uint8_t * current = data + (position - base);
+	//candidates must be inside the window and the data we have
+	const int64_t minPosition = std::max(windowStart, base);
+	int32_t bestLength = 0;
+	//compare a candidate with the current position and keep it if it is longer than the best match so far
+	auto checkCandidate = [&](int64_t candidate)
+	{
+		//clamp match so the source does not overlap the current position
+		const int32_t candidateMaxLength = overlap ? maxLength : static_cast<int32_t>(std::min<int64_t>(maxLength, position - candidate));
+		const uint8_t * candidateData = data + (candidate - base);
+		//only compare if the candidate can be longer than the best match so far. check the byte that would make it longer first
+		if (candidateMaxLength > bestLength && candidateData[bestLength] == current[bestLength])
+		{
+			const int32_t length = matchLength(current, candidateData, candidateMaxLength);
+			if (length > bestLength)
+			{
+				bestLength = length;
+				matchPosition = candidate;
+			}
+		}
+	};
+	int64_t candidate = m_head[hash(current)];
+	for (uint32_t chainLength = 0; chainLength < m_maxChainLength && candidate >= minPosition; ++chainLength)
+	{
+		//positions may have been inserted past the current position already. skip them
+		if (candidate < position)
+		{
+			checkCandidate(candidate);
+			//if we have reached the maximum length, we don't need to search anymore
+			if (bestLength == maxLength)
+			{
+				break;
+			}
+		}
+		//the chain link of a position is overwritten once the chains don't reach back to it anymore
+		if (candidate + m_chainSize < m_nextPosition)
+		{
+			break;
+		}
+		candidate = m_chain[static_cast<uint32_t>(candidate) & (m_chainSize - 1)];
+	}
+	//check the last position with the same long hash. it can be further back than the chains reach
+	if (m_longTable != nullptr && bestLength < maxLength && maxLength >= static_cast<int32_t>(LongHashLength))
+	{
+		const int64_t index = longHash(current);
+		if (index >= 0 && m_longTable[index] >= minPosition && m_longTable[index] < position)
+		{
+			checkCandidate(m_longTable[index]);
+		}
+	}
+	//a hash collision can give us shorter matches
+	return bestLength >= static_cast<int32_t>(m_hashLength) ? bestLength : 0;
+}
+
+int32_t LZMatchFinder::matchLength(const uint8_t * a, const uint8_t * b, int32_t maxLength)
+{
+	int32_t length = 0;
+	//compare as many bytes at once as we can. the lowest bit set in the mismatch mask is the first byte that differs
+#if defined(__AVX2__)
+	while (length + 32 <= maxLength)
+	{
+		const __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + length));
+		const __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + length));
+		const uint32_t mismatches = ~static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(va, vb)));
+		if (mismatches != 0)
+		{
+			return length + static_cast<int32_t>(Tools::lowestBitSet(mismatches));
+		}
+		length += 32;
+	}
+#endif
+#if defined(LZ_MATCHFINDER_SSE2)
+	while (length + 16 <= maxLength)
+	{
+		const __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a + length));
+		const __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + length));
+		const uint32_t mismatches = ~static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(va, vb))) & 0xFFFF;
+		if (mismatches != 0)
+		{
+			return length + static_cast<int32_t>(Tools::lowestBitSet(mismatches));
+		}
+		length += 16;
+	}
+#endif
+#if defined(LZ_MATCHFINDER_LITTLE_ENDIAN)
+	while (length + 8 <= maxLength)
+	{
+		uint64_t va;
+		uint64_t vb;
+		std::memcpy(&va, a + length, 8);
+		std::memcpy(&vb, b + length, 8);
+		const uint64_t mismatches = va ^ vb;
+		if (mismatches != 0)
+		{
+			return length + static_cast<int32_t>(Tools::lowestBitSet(mismatches) / 8);
+		}
+		length += 8;
+	}
+#endif
+	while (length < maxLength && a[length] == b[length])
+	{
+		++length;
+	}
+	return length;
+}
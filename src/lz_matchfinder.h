@@ -0,0 +1,93 @@
+#pragma once
+
+#include <inttypes.h>
+#include <cstddef>
+
+
+/// @brief Hash chain match finder for LZ codecs.
+/// Positions are inserted into chains of positions that start with the same bytes while the window slides over the data,
+/// so finding a match does not depend on the size of the window, but only on the number of candidates checked.
+/// The chains only reach back chainSize positions, so memory does not grow with the window. For windows bigger than
+/// that, an optional long-range table remembers the last position of hashes of LongHashLength bytes. Only positions
+/// with certain hash values are stored, so the table covers a big window. Repeated data hits the same positions again.
+/// Positions are absolute positions in the input. The data passed in only needs to hold the window and the look-ahead buffer.
+/// @note The finder does not own its memory. Pass storage from a Workspace or a vector.
+class LZMatchFinder
+{
+public:
+	/// @brief Minimum number of bytes hashed to find candidates.
+	static const uint32_t MinHashLength;
+	/// @brief Maximum number of bytes hashed to find candidates.
+	static const uint32_t MaxHashLength;
+	/// @brief Number of bytes hashed for the long-range table.
+	static const uint32_t LongHashLength;
+
+	/// @brief Set up the match finder and reset it to position 0.
+	/// @param head Storage for chain heads of at least (1 << hashBits) entries.
+	/// @param hashBits Number of bits of the hash values.
+	/// @param chain Storage for chain links of at least chainSize entries.
+	/// @param chainSize Number of positions the chains reach back. Must be a power of 2. Usually the size of the window
+	/// in which matches are searched. If it is smaller, older positions are only found through heads and the long-range table.
+	/// @param hashLength Number of bytes hashed [2,4]. Should be the minimum match length. Matches must be at least this long.
+	/// @param maxChainLength Maximum number of candidates checked per search.
+	LZMatchFinder(int64_t * head, uint32_t hashBits, int64_t * chain, uint32_t chainSize, uint32_t hashLength, uint32_t maxChainLength);
+
+	/// @brief Use a long-range table to find matches further back than the chains reach. Call before inserting positions.
+	/// @param table Storage for at least (1 << tableBits) entries.
+	/// @param tableBits Number of bits of the long-range hash values.
+	/// @param sampleBits Only store 1 of 2^sampleBits positions, chosen by their hash value.
+	void setLongRangeTable(int64_t * table, uint32_t tableBits, uint32_t sampleBits);
+
+	/// @brief Forget all inserted positions and restart at position.
+	/// @param position Next position to insert.
+	void reset(int64_t position = 0);
+
+	/// @brief Insert all positions that are not inserted yet up to, but not including position.
+	/// Positions where less than hashLength bytes are available before end are kept pending until more data is available.
+	/// @param data Pointer to input data at position base.
+	/// @param base Absolute position of data[0].
+	/// @param position Insert positions before this position.
+	/// @param end Absolute position of the end of the available data.
+	void insert(const uint8_t * data, int64_t base, int64_t position, int64_t end);
+
+	/// @brief Find the longest match for the data at position. Call insert() for all positions before first.
+	/// Unless overlapping is allowed, matches never overlap position, so the match source ends before position.
+	/// Positions after position may have been inserted already, e.g. when the caller searches the same data again.
+	/// @param data Pointer to input data at position base.
+	/// @param base Absolute position of data[0].
+	/// @param position Absolute position to find a match for.
+	/// @param windowStart Absolute position of the first byte a match may start at.
+	/// @param maxLength Maximum match length. data must hold maxLength bytes from position.
+	/// @param matchPosition Absolute position of the match found.
+	/// @param overlap If true, matches may run into position. This is fine for decoders that copy matches front to back.
+	/// @return Length of the match found. 0 if no match of at least hashLength bytes was found.
+	int32_t find(const uint8_t * data, int64_t base, int64_t position, int64_t windowStart, int32_t maxLength, int64_t & matchPosition, bool overlap = false) const;
+
+	/// @brief Count how many bytes at a and b are equal. Compares 32 bytes at once with AVX2 or 16 bytes with SSE2, if
+	/// the compiler targets it, then 8 bytes at once on little-endian machines, then single bytes. Only maxLength bytes are read.
+	/// @param a Pointer to first data.
+	/// @param b Pointer to second data.
+	/// @param maxLength Maximum number of bytes compared.
+	/// @return Number of equal bytes at the start of a and b.
+	static int32_t matchLength(const uint8_t * a, const uint8_t * b, int32_t maxLength);
+
+private:
+	/// @brief Hash hashLength bytes at data.
+	uint32_t hash(const uint8_t * data) const;
+
+	/// @brief Hash LongHashLength bytes at data for the long-range table.
+	/// @return Returns the table index or -1 if the position is not stored in the table.
+	int64_t longHash(const uint8_t * data) const;
+
+	int64_t * m_head;
+	uint32_t m_hashBits;
+	int64_t * m_chain;
+	uint32_t m_chainSize;
+	uint32_t m_hashLength;
+	uint32_t m_maxChainLength;
+	int64_t * m_longTable = nullptr;
+	uint32_t m_longTableBits = 0;
+	uint32_t m_longSampleBits = 0;
+	/// @brief Next position that needs to be inserted.
+	int64_t m_nextPosition = 0;
+};
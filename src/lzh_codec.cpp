@@ -0,0 +1,375 @@
+#include "lzh_codec.h"
+
+#include "tools.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+
+const uint8_t LZH::CodecIdentifier = 80;
+const uint32_t LZH::MinLevel = 1;
+const uint32_t LZH::MaxLevel = 9;
+const uint32_t LZH::DefaultLevel = 6;
+const uint32_t LZH::BlockSize = 1 << 17;
+const uint32_t LZH::MinWindowSize = 1 << 16;
+const uint32_t LZH::MaxWindowSize = 1 << 26;
+const size_t LZH::MinMatchFinderMemory = 2 * 1024 * 1024;
+const size_t LZH::DefaultMatchFinderMemory = 32 * 1024 * 1024;
+
+/// @brief Minimum length of a match.
+static const int32_t MinMatchLength = 3;
+/// @brief Maximum length of a match.
+static const int32_t MaxMatchLength = 258;
+/// @brief Matches of MinMatchLength further away than this are more expensive than literals.
+static const int64_t MinMatchMaxDistance = 4096;
+/// @brief Matches of MinMatchLength + 1 further away than this are more expensive than literals.
+static const int64_t ShortMatchMaxDistance = 1 << 20;
+/// @brief Number of bits of the match finder hash.
+static const uint32_t HashBits = 16;
+/// @brief Lazy parsing stops looking for a better match if a match is at least this long.
+static const int32_t NiceMatchLength = 128;
+
+/// @brief Maximum length of Huffman codes. The decoder uses a table of 2^MaxCodeLength entries.
+static const uint8_t MaxCodeLength = 12;
+/// @brief Number of symbols for literals and match lengths. Literals are 0-255, lengths start at 256.
+static const uint32_t LiteralLengthSymbols = 256 + 29;
+/// @brief Number of symbols for match distances. Covers distances up to MaxWindowSize.
+static const uint32_t DistanceSymbols = 52;
+
+/// @brief Length symbol base values and number of extra bits. Same as in Deflate.
+static const uint16_t LengthBase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+static const uint8_t LengthExtraBits[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+
+/// @brief Compression level parameters. Levels are 1-based.
+static const struct { uint32_t maxChainLength; bool lazy; } LevelParameters[9] = {
+	{ 4, false }, { 8, false }, { 16, false },
+	{ 16, true }, { 32, true }, { 64, true }, { 128, true },
+	{ 512, true }, { 4096, true }
+};
+
+/// @brief Symbol for a match length.
+static uint32_t lengthSymbol(uint32_t length)
+{
+	return static_cast<uint32_t>(std::upper_bound(LengthBase, LengthBase + 29, length) - LengthBase) - 1;
+}
+
+/// @brief Number of extra bits of a distance symbol.
+static uint32_t distanceExtraBits(uint32_t symbol)
+{
+	return symbol < 4 ? 0 : (symbol >> 1) - 1;
+}
+
+/// @brief Smallest distance of a distance symbol. The first 30 symbols are the same as in Deflate.
+static uint32_t distanceBase(uint32_t symbol)
+{
+	return symbol < 4 ? symbol + 1 : ((2 | (symbol & 1)) << distanceExtraBits(symbol)) + 1;
+}
+
+/// @brief Symbol for a match distance - 1. Every power of 2 is split into two symbols.
+static uint32_t distanceSymbol(uint32_t distanceMinusOne)
+{
+	if (distanceMinusOne < 4)
+	{
+		return distanceMinusOne;
+	}
+	const uint32_t highestBit = Tools::highestBitSet(distanceMinusOne);
+	return 2 * highestBit + ((distanceMinusOne >> (highestBit - 1)) & 1);
+}
+
+uint8_t LZH::codecIdentifier() const
+{
+	return CodecIdentifier;
+}
+
+std::string LZH::codecName() const
+{
+	return "LZH";
+}
+
+LZH * LZH::Create()
+{
+	return new LZH();
+}
+
+void LZH::setCompressionParameters(const uint32_t level)
+{
+	m_level = std::min(std::max(level, MinLevel), MaxLevel);
+	m_maxChainLength = LevelParameters[m_level - 1].maxChainLength;
+	m_lazy = LevelParameters[m_level - 1].lazy;
+}
+
+void LZH::setWindowParameters(const uint32_t windowSize, const size_t matchFinderMemory)
+{
+	m_windowSize = 1U << Tools::highestBitSet(std::min(std::max(windowSize, MinWindowSize), MaxWindowSize));
+	m_matchFinderMemory = std::max(matchFinderMemory, MinMatchFinderMemory);
+}
+
+size_t LZH::encodeBound(size_t size) const
+{
+	//a match never needs more bits than its bytes as literals, so the worst case is MaxCodeLength bits for every byte
+	const size_t blockCount = (size + BlockSize - 1) / BlockSize;
+	return Tools::MaxSizeBytes + blockCount * (((LiteralLengthSymbols + DistanceSymbols) * 4 + 7) / 8) + (size * MaxCodeLength + 7) / 8 + 4;
+}
+
+size_t LZH::parseBlock(const uint8_t * source, int64_t blockStart, int64_t blockEnd, LZMatchFinder & matchFinder, uint64_t * tokens) const
+{
+	//find the longest match at a position that is cheaper than literals. short matches need to be close
+	const int64_t maxDistance = m_windowSize - 1;
+	int64_t lastDistance = 0;
+	auto findMatch = [&](int64_t position, int64_t & matchPosition) -> int32_t
+	{
+		matchFinder.insert(source, 0, position, blockEnd);
+		const int32_t maxLength = static_cast<int32_t>(std::min<int64_t>(MaxMatchLength, blockEnd - position));
+		int32_t length = matchFinder.find(source, 0, position, std::max<int64_t>(0, position - maxDistance), maxLength, matchPosition, true);
+		//a long repeat continues at the distance of the last match, even if the chains don't reach back that far
+		if (lastDistance > 0 && position >= lastDistance)
+		{
+			const int32_t lastLength = LZMatchFinder::matchLength(source + position, source + position - lastDistance, maxLength);
+			if (lastLength > length)
+			{
+				length = lastLength;
+				matchPosition = position - lastDistance;
+			}
+		}
+		const int64_t distance = position - matchPosition;
+		const int32_t minLength = distance <= MinMatchMaxDistance ? MinMatchLength : (distance <= ShortMatchMaxDistance ? MinMatchLength + 1 : MinMatchLength + 2);
+		return length >= minLength ? length : 0;
+	};
+	size_t tokenCount = 0;
+	int64_t position = blockStart;
+	while (position < blockEnd)
+	{
+		int64_t matchPosition = 0;
+		int32_t matchLength = findMatch(position, matchPosition);
+		if (m_lazy && matchLength > 0)
+		{
+			//output a literal instead as long as the match at the next position is longer
+			while (matchLength < NiceMatchLength && position + 1 < blockEnd)
+			{
+				int64_t nextPosition = 0;
+				const int32_t nextLength = findMatch(position + 1, nextPosition);
+				if (nextLength <= matchLength)
+				{
+					break;
+				}
+				tokens[tokenCount++] = source[position++];
+				matchLength = nextLength;
+				matchPosition = nextPosition;
+			}
+		}
+		if (matchLength > 0)
+		{
+			lastDistance = position - matchPosition;
+			tokens[tokenCount++] = (static_cast<uint64_t>(matchLength) << 32) | static_cast<uint64_t>(lastDistance - 1);
+			position += matchLength;
+		}
+		else
+		{
+			tokens[tokenCount++] = source[position++];
+		}
+	}
+	return tokenCount;
+}
+
+size_t LZH::encodeInto(const uint8_t * source, size_t size, uint8_t * dest, size_t destSize, Workspace & workspace) const
+{
+	if (size > 0 && destSize >= encodeBound(size))
+	{
+		size_t destIndex = 0;
+		//output source size
+		Tools::writeSize(dest, destIndex, size);
+		//the chains cover as much of the window as the memory allows. the rest goes to the long-range table
+		const size_t chainMemory = m_matchFinderMemory - (sizeof(int64_t) << HashBits);
+		uint32_t chainSize = m_windowSize;
+		uint32_t longRangeBits = 0;
+		if (chainMemory / sizeof(int64_t) < m_windowSize)
+		{
+			longRangeBits = Tools::highestBitSet(static_cast<uint32_t>(chainMemory / 2 / sizeof(int64_t)));
+			chainSize = 1U << longRangeBits;
+		}
+		LZMatchFinder matchFinder(workspace.get<int64_t>(0, size_t(1) << HashBits), HashBits, workspace.get<int64_t>(1, chainSize), chainSize, MinMatchLength, m_maxChainLength);
+		if (longRangeBits > 0)
+		{
+			//store about as many positions as the table has entries in the window
+			const uint32_t windowBits = Tools::highestBitSet(m_windowSize);
+			matchFinder.setLongRangeTable(workspace.get<int64_t>(3, size_t(1) << longRangeBits), longRangeBits, windowBits > longRangeBits ? windowBits - longRangeBits : 0);
+		}
+		if (m_verbose) std::cout << "Match finder chains reach back " << chainSize << " bytes of the " << m_windowSize << " byte window." << std::endl;
+		if (m_verbose) std::cout << "Compressing with LZH encoder... ";
+		uint64_t * tokens = workspace.get<uint64_t>(2, BlockSize);
+		uint32_t buffer = 0;
+		uint32_t availableBits = 32;
+		auto outputValue = [&](uint32_t value, uint32_t bits)
+		{
+			if (bits > 0)
+			{
+				buffer |= value << (availableBits - bits);
+				availableBits -= bits;
+				Tools::outputBits(dest, destIndex, buffer, availableBits);
+			}
+		};
+		const int64_t srcSize = static_cast<int64_t>(size);
+		for (int64_t blockStart = 0; blockStart < srcSize; blockStart += BlockSize)
+		{
+			const int64_t blockEnd = std::min<int64_t>(blockStart + BlockSize, srcSize);
+			const size_t tokenCount = parseBlock(source, blockStart, blockEnd, matchFinder, tokens);
+			//count symbol frequencies and build codes for this block
+			uint32_t literalLengthFrequencies[LiteralLengthSymbols] = { 0 };
+			uint32_t distanceFrequencies[DistanceSymbols] = { 0 };
+			for (size_t i = 0; i < tokenCount; ++i)
+			{
+				const uint64_t token = tokens[i];
+				if (token < 256)
+				{
+					literalLengthFrequencies[token]++;
+				}
+				else
+				{
+					literalLengthFrequencies[256 + lengthSymbol(static_cast<uint32_t>(token >> 32))]++;
+					distanceFrequencies[distanceSymbol(static_cast<uint32_t>(token))]++;
+				}
+			}
+			const HuffmanCodes literalLengthCodes = buildCanonicalCodes(literalLengthFrequencies, LiteralLengthSymbols, MaxCodeLength);
+			const HuffmanCodes distanceCodes = buildCanonicalCodes(distanceFrequencies, DistanceSymbols, MaxCodeLength);
+			//output code lengths
+			for (const auto & code : literalLengthCodes)
+			{
+				outputValue(code.length, 4);
+			}
+			for (const auto & code : distanceCodes)
+			{
+				outputValue(code.length, 4);
+			}
+			//output literals and matches
+			for (size_t i = 0; i < tokenCount; ++i)
+			{
+				const uint64_t token = tokens[i];
+				if (token < 256)
+				{
+					outputValue(literalLengthCodes[token].code, literalLengthCodes[token].length);
+				}
+				else
+				{
+					const uint32_t length = static_cast<uint32_t>(token >> 32);
+					const uint32_t lengthIndex = lengthSymbol(length);
+					const HuffmanCode & lengthCode = literalLengthCodes[256 + lengthIndex];
+					outputValue(lengthCode.code, lengthCode.length);
+					outputValue(length - LengthBase[lengthIndex], LengthExtraBits[lengthIndex]);
+					const uint32_t distanceMinusOne = static_cast<uint32_t>(token);
+					const uint32_t distanceIndex = distanceSymbol(distanceMinusOne);
+					outputValue(distanceCodes[distanceIndex].code, distanceCodes[distanceIndex].length);
+					outputValue(distanceMinusOne + 1 - distanceBase(distanceIndex), distanceExtraBits(distanceIndex));
+				}
+			}
+		}
+		//now if we still have remaining bits, dump buffer byte, which automatically adds the bits plus trailing zero bits
+		Tools::outputBits(dest, destIndex, buffer, availableBits, true);
+		if (m_verbose) std::cout << "Done." << std::endl;
+		return destIndex;
+	}
+	return 0;
+}
+
+size_t LZH::decodedSize(const uint8_t * source, size_t size) const
+{
+	size_t srcIndex = 0;
+	uint64_t destSize = 0;
+	return Tools::readSize(source, size, srcIndex, destSize) ? static_cast<size_t>(destSize) : 0;
+}
+
+bool LZH::buildDecodeTable(const HuffmanCodes & codes, uint16_t * table)
+{
+	const uint32_t tableSize = 1 << MaxCodeLength;
+	std::fill_n(table, tableSize, 0);
+	for (const auto & code : codes)
+	{
+		if (code.length > 0)
+		{
+			//all table entries starting with the code decode to the symbol
+			const uint32_t shift = MaxCodeLength - code.length;
+			const uint32_t start = code.code << shift;
+			const uint32_t end = (code.code + 1) << shift;
+			if (end > tableSize)
+			{
+				return false;
+			}
+			std::fill(table + start, table + end, static_cast<uint16_t>((code.symbol << 4) | code.length));
+		}
+	}
+	return true;
+}
+
+size_t LZH::decodeInto(const uint8_t * source, size_t size, uint8_t * dest, size_t destCapacity, Workspace & workspace) const
+{
+	// read result size
+	size_t srcIndex = 0;
+	uint64_t destSize = 0;
+	if (Tools::readSize(source, size, srcIndex, destSize) && destSize > 0 && destSize <= destCapacity)
+	{
+		uint16_t * literalLengthTable = workspace.get<uint16_t>(0, size_t(1) << MaxCodeLength);
+		uint16_t * distanceTable = workspace.get<uint16_t>(1, size_t(1) << MaxCodeLength);
+		Tools::BitReader reader(source + srcIndex, size - srcIndex);
+		uint8_t * out = dest;
+		uint8_t * const outEnd = dest + destSize;
+		while (out < outEnd)
+		{
+			uint8_t * const blockEnd = out + std::min<size_t>(BlockSize, outEnd - out);
+			// read code lengths and build decoding tables
+			uint8_t lengths[LiteralLengthSymbols + DistanceSymbols];
+			for (uint32_t i = 0; i < LiteralLengthSymbols + DistanceSymbols; ++i)
+			{
+				reader.refill();
+				lengths[i] = static_cast<uint8_t>(reader.get(4));
+				if (lengths[i] > MaxCodeLength)
+				{
+					return 0;
+				}
+			}
+			if (!buildDecodeTable(canonicalCodesFromLengths(lengths, LiteralLengthSymbols), literalLengthTable) ||
+				!buildDecodeTable(canonicalCodesFromLengths(lengths + LiteralLengthSymbols, DistanceSymbols), distanceTable))
+			{
+				return 0;
+			}
+			// decode literals and matches. a refill gives us enough bits for a whole match
+			while (out < blockEnd)
+			{
+				reader.refill();
+				const uint16_t entry = literalLengthTable[reader.peek(MaxCodeLength)];
+				if ((entry & 15) == 0)
+				{
+					return 0;
+				}
+				reader.skip(entry & 15);
+				const uint32_t symbol = entry >> 4;
+				if (symbol < 256)
+				{
+					*out++ = static_cast<uint8_t>(symbol);
+				}
+				else
+				{
+					const uint32_t lengthIndex = symbol - 256;
+					const size_t matchLength = LengthBase[lengthIndex] + reader.get(LengthExtraBits[lengthIndex]);
+					const uint16_t distanceEntry = distanceTable[reader.peek(MaxCodeLength)];
+					if ((distanceEntry & 15) == 0)
+					{
+						return 0;
+					}
+					reader.skip(distanceEntry & 15);
+					const uint32_t distanceIndex = distanceEntry >> 4;
+					const size_t offset = distanceBase(distanceIndex) + reader.get(distanceExtraBits(distanceIndex));
+					if (offset > static_cast<size_t>(out - dest) || matchLength > static_cast<size_t>(blockEnd - out))
+					{
+						return 0;
+					}
+					out = Tools::copyMatch(out, offset, matchLength, outEnd);
+				}
+				if (reader.overrun())
+				{
+					return 0;
+				}
+			}
+		}
+		return static_cast<size_t>(destSize);
+	}
+	return 0;
+}
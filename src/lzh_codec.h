@@ -0,0 +1,119 @@
+#pragma once
+
+#include "codec.h"
+#include "huffman_codes.h"
+#include "lz_matchfinder.h"
+#include <inttypes.h>
+
+
+/// @brief LZ compressor that Huffman-codes its literals, match lengths and match distances like Deflate.
+// Compressed data layout:
+// 00h | uint32_t | Size of uncompressed data. 0xFFFFFFFF if followed by a uint64_t size (see Tools::writeSize()).
+// 04h | bits     | Blocks of BlockSize bytes of uncompressed data. Every block starts with the code lengths (4 bits each)
+//     |          | of the 285 literal/length and the 52 distance symbols, followed by the Huffman-coded sequences.
+class LZH : public I_Codec
+{
+public:
+	/// @brief Codec identifier. Do not change this and make sure there are no duplicate identifiers!
+	static const uint8_t CodecIdentifier;
+
+	/// @brief Lowest compression level. Fastest, greedy parsing checking few match candidates.
+	static const uint32_t MinLevel;
+	/// @brief Highest compression level. Slowest, lazy parsing checking many match candidates.
+	static const uint32_t MaxLevel;
+	/// @brief Compression level used if none is set.
+	static const uint32_t DefaultLevel;
+
+	/// @brief Number of bytes of uncompressed data coded with the same Huffman codes.
+	static const uint32_t BlockSize;
+
+	/// @brief Smallest window in which matches are searched.
+	static const uint32_t MinWindowSize;
+	/// @brief Biggest window in which matches are searched.
+	static const uint32_t MaxWindowSize;
+	/// @brief Smallest amount of memory the match finder may use.
+	static const size_t MinMatchFinderMemory;
+	/// @brief Memory the match finder uses at most if no other value is set.
+	static const size_t DefaultMatchFinderMemory;
+
+	/// @brief Typedef for sharing a codec. Used in Compressor::compress().
+	typedef std::shared_ptr<LZH> SPtr;
+
+	/// @brief Create a new codec instance.
+	/// @return Return codec instance.
+	static LZH * Create();
+
+	/// @brief Codec identifier.
+	/// @return Codec identifier.
+	virtual uint8_t codecIdentifier() const override;
+
+	/// @brief Codec (human-readable) name.
+	/// @return Codec name.
+	virtual std::string codecName() const override;
+
+	/// @brief Set the compression level. Levels 1-3 parse greedily, 4-9 lazily and higher levels check more match candidates.
+	/// @param level Compression level [MinLevel,MaxLevel].
+	void setCompressionParameters(const uint32_t level = 6);
+
+	/// @brief Set the size of the window in which matches are searched and how much memory the match finder may use.
+	/// The hash chains cover as much of the window as the memory allows. Matches further back are found through a
+	/// table of the last positions of 8-byte strings, which is good at finding long repeats, e.g. repeated records or frames.
+	/// Only the encoder uses the window size. The decoder reads matches from all data decoded so far.
+	/// Matches never reach beyond the data passed to encode(), so a window bigger than the compressor block size does not help.
+	/// @param windowSize Window size [MinWindowSize,MaxWindowSize]. Rounded down to a power of 2.
+	/// @param matchFinderMemory Maximum memory in bytes used by the match finder. At least MinMatchFinderMemory.
+	void setWindowParameters(const uint32_t windowSize = 1 << 16, const size_t matchFinderMemory = 32 * 1024 * 1024);
+
+	/// @brief Worst-case size of the data encodeInto() produces with the current settings.
+	/// @param size Size of source data.
+	/// @return Returns the size of header data, the code lengths of all blocks and the longest code for every byte.
+	virtual size_t encodeBound(size_t size) const override;
+
+	/// @brief Find LZ matches in the window and code the literals and matches with canonical Huffman codes.
+	/// Literals and match lengths 3-258 share one alphabet, match distances 1-64MB have their own one. Lengths and
+	/// distances are coded as a symbol for their range plus extra bits like in Deflate, so near matches need fewer
+	/// bits than far matches. Every block has its own codes.
+	/// @param source Pointer to source data.
+	/// @param size Size of source data.
+	/// @param dest Pointer to destination buffer.
+	/// @param destSize Size of destination buffer. Must be at least encodeBound(size).
+	/// @param workspace Scratch memory reused across calls.
+	/// @return Number of bytes written to dest. 0 if encoding failed.
+	virtual size_t encodeInto(const uint8_t * source, size_t size, uint8_t * dest, size_t destSize, Workspace & workspace) const override;
+
+	/// @brief Size of the data decodeInto() produces.
+	/// @param source Pointer to compressed data.
+	/// @param size Size of compressed data.
+	/// @return Returns the size stored in the header of the compressed data. 0 if the size could not be determined.
+	virtual size_t decodedSize(const uint8_t * source, size_t size) const override;
+
+	/// @brief Decode LZ data with Huffman-coded literals and matches.
+	/// Symbols are decoded with a single table lookup, because codes are at most 12 bits long.
+	/// @param source Pointer to compressed data.
+	/// @param size Size of compressed data.
+	/// @param dest Pointer to destination buffer.
+	/// @param destSize Size of destination buffer. Must be at least decodedSize(source, size).
+	/// @param workspace Scratch memory reused across calls.
+	/// @return Number of bytes written to dest. 0 if decoding failed.
+	virtual size_t decodeInto(const uint8_t * source, size_t size, uint8_t * dest, size_t destSize, Workspace & workspace) const override;
+
+private:
+	/// @brief Parse a block of source data into literals and matches.
+	/// @return Returns the number of tokens stored. A literal is stored as its value, a match as (length << 32) | (distance - 1).
+	size_t parseBlock(const uint8_t * source, int64_t blockStart, int64_t blockEnd, LZMatchFinder & matchFinder, uint64_t * tokens) const;
+
+	/// @brief Build a decoding table with an entry of (symbol << 4) | length for every 12-bit value.
+	/// @return Returns false if the codes are over-subscribed.
+	static bool buildDecodeTable(const HuffmanCodes & codes, uint16_t * table);
+
+	/// @brief Compression level.
+	uint32_t m_level = 6;
+	/// @brief Maximum number of match candidates checked per position.
+	uint32_t m_maxChainLength = 64;
+	/// @brief If true, check if the match at the next position is longer before taking a match.
+	bool m_lazy = true;
+	/// @brief Size of the window in which matches are searched.
+	uint32_t m_windowSize = 1 << 16;
+	/// @brief Maximum memory used by the match finder.
+	size_t m_matchFinderMemory = 32 * 1024 * 1024;
+};
@@ -1,11 +1,9 @@
 #include "lzss_codec.h"
 
 #include "tools.h"
-#include <array>
-#include <list>
-#include <numeric>
 #include <algorithm>
-#include "../sais/sais.hxx"
+#include <atomic>
+#include <cstring>
 
 #include <iostream>
 
@@ -13,6 +11,21 @@
 
 
 const uint8_t LZSS::CodecIdentifier = 70;
+const uint8_t LZSS::ChunkedFlag = 0x80;
+const uint8_t LZSS::ChunkDictionaryFlag = 0x01;
+const uint8_t LZSS::RepMatchFlag = 0x40;
+const uint8_t LZSS::PresetDictionaryFlag = 0x20;
+const uint32_t LZSS::RepCount;
+const uint32_t LZSS::MinLevel = 1;
+const uint32_t LZSS::MaxLevel = 9;
+const uint32_t LZSS::DefaultLevel = 6;
+
+/// @brief Match candidates checked per position and parsing (0 = greedy, 1 = lazy, 2 = optimal) for compression levels 1-9.
+static const struct { uint32_t maxChainLength; uint8_t parsing; } LevelParameters[9] = {
+	{ 1, 0 }, { 4, 0 }, { 16, 0 },
+	{ 16, 1 }, { 64, 1 }, { 256, 1 }, { 1024, 1 },
+	{ 256, 2 }, { 1024, 2 }
+};
 
 uint8_t LZSS::codecIdentifier() const
 {
@@ -29,7 +42,7 @@ LZSS * LZSS::Create()
 	return new LZSS();
 }
 
-void LZSS::setCompressionParameters(const uint32_t dictionaryBits, const uint32_t matchLengthBits)
+void LZSS::setCompressionParameters(const uint32_t dictionaryBits, const uint32_t matchLengthBits, const uint32_t level)
 {
 	m_dictionaryBits = dictionaryBits;
 	if (m_dictionaryBits < 4)
@@ -53,10 +66,40 @@ void LZSS::setCompressionParameters(const uint32_t dictionaryBits, const uint32_
 	}
 	m_matchLengthMin = ((m_dictionaryBits + m_matchLengthBits + 7) / 8) + 1;
 	m_matchLengthMax = ((1 << m_matchLengthBits) - 1) + m_matchLengthMin;
+	m_level = std::min(std::max(level, MinLevel), MaxLevel);
+	m_maxChainLength = LevelParameters[m_level - 1].maxChainLength;
+	m_parsing = static_cast<Parsing>(LevelParameters[m_level - 1].parsing);
+}
+
+
+void LZSS::setChunkParameters(const uint32_t chunkSize, const bool chunkDictionary)
+{
+	m_chunkSize = chunkSize;
+	m_chunkDictionary = chunkDictionary;
+}
+
+void LZSS::setRepMatches(const bool repMatches)
+{
+	m_repMatches = repMatches;
 }
 
+void LZSS::setDictionary(std::shared_ptr<const std::vector<uint8_t>> dictionary)
+{
+	//the compressor hands the dictionary to its decoders for every block, so only calculate the checksum for new data
+	if (dictionary != m_dictionary)
+	{
+		m_dictionaryChecksum = dictionary ? Tools::calculateAdler32(dictionary->data(), dictionary->size()) : 0;
+	}
+	I_Codec::setDictionary(dictionary);
+}
 
-void LZSS::outputVerbatim(uint8_t symbol, std::vector<uint8_t> & dest, uint32_t & destIndex, uint32_t & buffer, uint32_t & bufferBits) const
+uint32_t LZSS::hashBits() const
+{
+	//use a hash table about the size of the dictionary
+	return static_cast<uint32_t>(std::min(std::max(m_dictionaryBits, 8), 16));
+}
+
+void LZSS::outputVerbatim(uint8_t symbol, uint8_t * dest, size_t & destIndex, uint32_t & buffer, uint32_t & bufferBits) const
 {
 	// add leading 0 to bits
 	buffer |= ((uint32_t)symbol) << (bufferBits - 9);
@@ -64,257 +107,1052 @@ void LZSS::outputVerbatim(uint8_t symbol, std::vector<uint8_t> & dest, uint32_t
 	Tools::outputBits(dest, destIndex, buffer, bufferBits);
 }
 
-void LZSS::outputMatch(int32_t index, int32_t length, std::vector<uint8_t> & dest, uint32_t & destIndex, uint32_t & buffer, uint32_t & bufferBits) const
+void LZSS::outputMatch(int32_t index, int32_t length, uint8_t * dest, size_t & destIndex, uint32_t & buffer, uint32_t & bufferBits) const
 {
-	// add leading 1 to bits
+	// add leading 1 to bits. with rep matches a 0 follows
 	buffer |= 1 << (bufferBits - 1);
-	bufferBits -= 1;
+	bufferBits -= m_repMatches ? 2 : 1;
 	// store match index in buffer
 	buffer |= index << (bufferBits - m_dictionaryBits);
 	bufferBits -= m_dictionaryBits;
+	// a match can have more bits than fit into the buffer at once, so output full bytes before adding the length
+	Tools::outputBits(dest, destIndex, buffer, bufferBits);
+	// store match length in buffer
+	buffer |= (length - m_matchLengthMin) << (bufferBits - m_matchLengthBits);
+	bufferBits -= m_matchLengthBits;
+	Tools::outputBits(dest, destIndex, buffer, bufferBits);
+}
+
+void LZSS::outputRepMatch(int32_t repIndex, int32_t length, uint8_t * dest, size_t & destIndex, uint32_t & buffer, uint32_t & bufferBits) const
+{
+	// add leading 11 and the rep index to bits
+	buffer |= (12 | repIndex) << (bufferBits - 4);
+	bufferBits -= 4;
 	// store match length in buffer
 	buffer |= (length - m_matchLengthMin) << (bufferBits - m_matchLengthBits);
 	bufferBits -= m_matchLengthBits;
 	Tools::outputBits(dest, destIndex, buffer, bufferBits);
 }
 
-std::vector<uint8_t> LZSS::encode(const std::vector<uint8_t> & source) const
+void LZSS::updateReps(RepDistances & reps, int32_t repIndex, int64_t distance)
 {
-	const int32_t srcSize = static_cast<int32_t>(source.size());
-	if (srcSize > 0)
+	// move the distance to the front. a new distance pushes out the oldest one
+	for (int32_t i = repIndex < 0 ? RepCount - 1 : repIndex; i > 0; --i)
 	{
-		std::vector<uint8_t> dest(srcSize + 6 + srcSize / 8);
-		uint32_t destIndex = 0;
-		//output source size
-		*((uint32_t *)&dest[destIndex]) = srcSize;
-		destIndex += 4;
-		//store dictionary bits and match length bits
-		dest[destIndex++] = static_cast<uint8_t>(m_dictionaryBits);
-		dest[destIndex++] = static_cast<uint8_t>(m_matchLengthBits);
-		//check if source size is bigger that look-ahead buffer size
-		if (srcSize > m_lookAheadSize)
-		{
-			int32_t dictStart = 0;
-			int32_t labStart = 0;
-			//allocate and clear left index array
-			std::array<int32_t, 256> LI;
-			std::array<int32_t, 256> RI;
-			//allocate space for dictionary suffix arrays
-			std::vector<int32_t> P(m_dictionarySize, -1);
-			//push m_lookAheadSize bytes straight to output and move look-ahead buffer to next block
-			std::copy(source.begin(), std::next(source.begin(), m_lookAheadSize), std::next(dest.begin(), destIndex));
-			destIndex += m_lookAheadSize;
-			labStart += m_lookAheadSize;
-			// build initial suffix array
-			saisxx<uint8_t *, int32_t *, int32_t>((uint8_t *)source.data(), P.data(), m_lookAheadSize);
-			//do LZSS encoding
-			uint32_t buffer = 0; //bit buffer holding encoded data
-			uint32_t availableBits = 32; //number of available bits in buffer we can fill with data
-			while (labStart < srcSize)
+		reps[i] = reps[i - 1];
+	}
+	reps[0] = distance;
+}
+
+int32_t LZSS::messageSavings(const Message & message) const
+{
+	if (message.length < m_matchLengthMin)
+	{
+		return 0;
+	}
+	const int32_t cost = message.repIndex >= 0 ? 4 + m_matchLengthBits : (m_repMatches ? 2 : 1) + m_dictionaryBits + m_matchLengthBits;
+	return 9 * message.length - cost;
+}
+
+LZSS::Message LZSS::findMessage(const uint8_t * data, int64_t base, int64_t position, int32_t maxLength, LZMatchFinder & matchFinder, const RepDistances & reps) const
+{
+	Message best = { 1, -1, 0 };
+	if (m_repMatches)
+	{
+		//check the rep distances first. they must be inside the dictionary and matches must not overlap the current position
+		const int64_t maxDistance = position - std::max(dictionaryStart(position), base);
+		for (int32_t i = 0; i < static_cast<int32_t>(RepCount); ++i)
+		{
+			if (reps[i] > 0 && reps[i] <= maxDistance)
 			{
-#ifdef DEBUG_OUTPUT
-				std::string dictString(std::next(source.cbegin(), dictStart), std::next(source.cbegin(), labStart));
-				std::cout << "DICT: " << dictString;
-#endif
-				// ---------- Build LI and RI arrays ----------
-				// clear left and right index array
-				std::fill(LI.begin(), LI.end(), -1);
-				std::fill(RI.begin(), RI.end(), -1);
-				//set up dictionary size
-				const int32_t dictSize = labStart - dictStart;
-				//scan suffix array P and update left-index LI and right-index RI
-				uint8_t previousSymbol = source[dictStart + P[0]];
-				//store index for first symbol
-				LI[previousSymbol] = 0;
-				for (int32_t pIndex = 1; pIndex < dictSize; ++pIndex)
+				const int32_t length = LZMatchFinder::matchLength(data + (position - base), data + (position - reps[i] - base), static_cast<int32_t>(std::min<int64_t>(maxLength, reps[i])));
+				const Message message = { length, i, position - reps[i] };
+				if (length >= m_matchLengthMin && messageSavings(message) > messageSavings(best))
 				{
-					//store index for previous symbol if the current symbol is different
-					const uint8_t currentSymbol = source[dictStart + P[pIndex]];
-					if (currentSymbol != previousSymbol)
-					{
-						RI[previousSymbol] = pIndex - 1;
-						LI[currentSymbol] = LI[currentSymbol] < 0 ? pIndex : LI[currentSymbol];
-						previousSymbol = currentSymbol;
-					}
+					best = message;
 				}
-				//store index for last symbol
-				RI[previousSymbol] = (uint32_t)dictSize - 1;
-				// ---------- Encode symbols ----------
-				//calculate next look-ahead buffer size. this is usually m_lookAheadSize, but can be less at the end of the file.
-				const int32_t labSize = labStart + m_lookAheadSize > srcSize ? srcSize - labStart : m_lookAheadSize;
+			}
+		}
+		//a rep match of the longest possible length can not be beaten
+		if (best.length == maxLength)
+		{
+			return best;
+		}
+	}
+	Message match = { 0, -1, 0 };
+	match.length = matchFinder.find(data, base, position, dictionaryStart(position), maxLength, match.matchPosition);
+	if (match.length >= m_matchLengthMin && messageSavings(match) > messageSavings(best))
+	{
+		best = match;
+	}
+	return best;
+}
+
+void LZSS::outputMessage(const Message & message, int64_t position, const uint8_t * data, int64_t base, RepDistances & reps, uint8_t * dest, size_t & destIndex, uint32_t & buffer, uint32_t & bufferBits) const
+{
+	if (message.length >= m_matchLengthMin)
+	{
+		if (message.repIndex >= 0)
+		{
+			outputRepMatch(message.repIndex, message.length, dest, destIndex, buffer, bufferBits);
+		}
+		else
+		{
+			// the index is relative to the start of the dictionary
+			outputMatch(static_cast<int32_t>(message.matchPosition - dictionaryStart(position)), message.length, dest, destIndex, buffer, bufferBits);
+		}
+		updateReps(reps, message.repIndex, position - message.matchPosition);
 #ifdef DEBUG_OUTPUT
-				std::string labString(std::next(source.cbegin(), labStart), std::next(source.cbegin(), labStart + labSize));
-				std::cout << " LAB: " << labString << std::endl;
-				std::cout << "P [";
-				std::for_each(P.cbegin(), P.cend(), [](const int32_t & p){ std::cout << p << ","; });
-				std::cout << "]" << std::endl;
+		std::string match(data + (message.matchPosition - base), data + (message.matchPosition - base) + message.length);
+		std::cout << match << " -> match index " << (message.matchPosition - dictionaryStart(position)) << ", length " << message.length << ", rep " << message.repIndex << std::endl;
 #endif
-				//encode symbols from look-ahead buffer
-				int32_t labEncoded = 0;
-				// try to find symbol in dictionary (through LI array)
-				const int32_t leftIndex = LI[source[labStart + labEncoded]];
-				if (leftIndex < 0)
-				{
-					//symbol not in dictionary. encode as single symbol
-					outputVerbatim(source[labStart + labEncoded], dest, destIndex, buffer, availableBits);
+	}
+	else
+	{
+		outputVerbatim(data[position - base], dest, destIndex, buffer, bufferBits);
 #ifdef DEBUG_OUTPUT
-					std::cout << source[labStart + labEncoded] << " -> not in dict" << std::endl;
+		std::cout << data[position - base] << " -> no match" << std::endl;
 #endif
-					labEncoded++;
-				}
-				else
-				{
-					//symbol in dictionary, find right end of suffixes
-					const int32_t rightIndex = RI[source[labStart + labEncoded]];
-					//locate longest match for best compression
-					int32_t matchLength = 1;
-					int32_t matchIndex = 0;
-					for (int32_t pIndex = leftIndex; pIndex <= rightIndex; ++pIndex)
-					{
-						//clamp search length to end of LAB, end of dictionary and maximum encodable length
-						const int32_t maxCmpLength = std::min(std::min(dictSize - P[pIndex], labSize - labEncoded), m_matchLengthMax);
-						if (maxCmpLength > m_matchLengthMin && maxCmpLength > matchLength)
-						{
-							//compare strings
-							auto compareStart = std::next(source.cbegin(), labStart + labEncoded);
-							const auto mismatches = std::mismatch(compareStart, std::next(compareStart, maxCmpLength), std::next(source.cbegin(), dictStart + P[pIndex]));
-							const int32_t length = std::distance(compareStart, mismatches.first);
-							if (length > matchLength)
-							{
-								matchLength = length;
-								matchIndex = pIndex;
-								//if we have reached the maximum encodable length, we don't need to search anymore
-								if (matchLength == m_matchLengthMax)
-								{
-									break;
-								}
-							}
-						}
-					}
-					//we have found a match now, check if long enough
-					if (matchLength >= m_matchLengthMin)
-					{
-						// match found. output it
-						outputMatch(P[matchIndex], matchLength, dest, destIndex, buffer, availableBits);
+	}
+}
+
+int64_t LZSS::dictionaryStart(int64_t position) const
+{
+	return position <= m_dictionarySize ? 0 : (position - m_dictionarySize);
+}
+
+int32_t LZSS::encodeMessages(const uint8_t * data, int64_t base, int64_t labStart, int32_t labSize, LZMatchFinder & matchFinder, ParseNode * nodes, RepDistances & reps, uint8_t * dest, size_t & destIndex, uint32_t & buffer, uint32_t & bufferBits) const
+{
+	if (m_parsing == Parsing::Optimal)
+	{
+		return encodeOptimal(data, base, labStart, labSize, matchFinder, nodes, reps, dest, destIndex, buffer, bufferBits);
+	}
+	const int64_t labEnd = labStart + labSize;
+	int64_t position = labStart;
+	//add all positions of the dictionary to the match finder
+	matchFinder.insert(data, base, position, labEnd);
+	//locate the best match for best compression. clamp length to end of LAB and maximum encodable length
+	Message message = findMessage(data, base, position, std::min(labSize, m_matchLengthMax), matchFinder, reps);
+	if (m_parsing == Parsing::Lazy)
+	{
+		//check if the next position has a better match. if so, output a verbatim byte and try again from there
+		while (message.length >= m_matchLengthMin && message.length < m_matchLengthMax && position + 1 < labEnd)
+		{
+			matchFinder.insert(data, base, position + 1, labEnd);
+			const Message next = findMessage(data, base, position + 1, static_cast<int32_t>(std::min<int64_t>(labEnd - position - 1, m_matchLengthMax)), matchFinder, reps);
+			if (messageSavings(next) <= messageSavings(message))
+			{
+				break;
+			}
+			outputVerbatim(data[position - base], dest, destIndex, buffer, bufferBits);
 #ifdef DEBUG_OUTPUT
-						std::string match(std::next(source.cbegin(), dictStart + P[matchIndex]), std::next(source.cbegin(), dictStart + P[matchIndex] + matchLength));
-						std::cout << match << " -> match index " << P[matchIndex] << ", length " << matchLength << std::endl;
+			std::cout << data[position - base] << " -> better match follows" << std::endl;
 #endif
-						labEncoded += matchLength;
-					}
-					else
+			++position;
+			message = next;
+		}
+	}
+	//output the match if it is long enough or a verbatim byte
+	outputMessage(message, position, data, base, reps, dest, destIndex, buffer, bufferBits);
+	return static_cast<int32_t>(position - labStart) + message.length;
+}
+
+int32_t LZSS::encodeOptimal(const uint8_t * data, int64_t base, int64_t labStart, int32_t labSize, LZMatchFinder & matchFinder, ParseNode * nodes, RepDistances & reps, uint8_t * dest, size_t & destIndex, uint32_t & buffer, uint32_t & bufferBits) const
+{
+	const int64_t labEnd = labStart + labSize;
+	//find longest match for every position of the LAB
+	for (int32_t i = 0; i < labSize; ++i)
+	{
+		const int64_t position = labStart + i;
+		matchFinder.insert(data, base, position, labEnd);
+		nodes[i].matchLength = matchFinder.find(data, base, position, dictionaryStart(position), std::min(labSize - i, m_matchLengthMax), nodes[i].matchPosition);
+		nodes[i + 1].cost = UINT32_MAX;
+	}
+	//find the cheapest way to reach every position of the LAB from its start. rep distances depend on the path taken,
+	//so they are passed along the cheapest path to every position
+	const uint32_t verbatimCost = 9;
+	const uint32_t matchCost = (m_repMatches ? 2 : 1) + m_dictionaryBits + m_matchLengthBits;
+	const uint32_t repMatchCost = 4 + m_matchLengthBits;
+	nodes[0].cost = 0;
+	nodes[0].reps = reps;
+	for (int32_t i = 0; i < labSize; ++i)
+	{
+		const int64_t position = labStart + i;
+		//the cheapest message reaching this node is known now. update the rep distances along it
+		if (i > 0)
+		{
+			const ParseNode & from = nodes[nodes[i].from];
+			nodes[i].reps = from.reps;
+			if (nodes[i].message.length > 1)
+			{
+				updateReps(nodes[i].reps, nodes[i].message.repIndex, labStart + nodes[i].from - nodes[i].message.matchPosition);
+			}
+		}
+		auto relax = [&](int32_t length, uint32_t cost, int32_t repIndex, int64_t matchPosition)
+		{
+			ParseNode & to = nodes[i + length];
+			if (nodes[i].cost + cost < to.cost)
+			{
+				to.cost = nodes[i].cost + cost;
+				to.from = i;
+				to.message.length = length;
+				to.message.repIndex = repIndex;
+				to.message.matchPosition = matchPosition;
+			}
+		};
+		relax(1, verbatimCost, -1, 0);
+		//any prefix of a match is a match too
+		for (int32_t length = m_matchLengthMin; length <= nodes[i].matchLength; ++length)
+		{
+			relax(length, matchCost, -1, nodes[i].matchPosition);
+		}
+		if (m_repMatches)
+		{
+			const int64_t maxDistance = position - std::max(dictionaryStart(position), base);
+			for (int32_t r = 0; r < static_cast<int32_t>(RepCount); ++r)
+			{
+				const int64_t distance = nodes[i].reps[r];
+				if (distance > 0 && distance <= maxDistance)
+				{
+					const int32_t repLength = LZMatchFinder::matchLength(data + (position - base), data + (position - distance - base), static_cast<int32_t>(std::min<int64_t>(std::min(labSize - i, m_matchLengthMax), distance)));
+					for (int32_t length = m_matchLengthMin; length <= repLength; ++length)
 					{
-						//no. just encode bytes of match verbatim
-						for (int32_t i = 0; i < matchLength; ++i)
-						{
-							outputVerbatim(source[labStart + labEncoded], dest, destIndex, buffer, availableBits);
-#ifdef DEBUG_OUTPUT
-							std::cout << source[labStart + labEncoded] << " -> match too short" << std::endl;
-#endif
-							labEncoded++;
-						}
+						relax(length, repMatchCost, r, position - distance);
 					}
 				}
-				// advance dictionary and LAB
-				labStart += labEncoded;
-				dictStart = labStart <= m_dictionarySize ? 0 : (labStart - m_dictionarySize);
-				// rebuild suffix array
-				saisxx<uint8_t *, int32_t *, int32_t>((uint8_t *)source.data() + dictStart, P.data(), labStart - dictStart);
 			}
-			//now if we still have remaining bits, dump buffer byte, which automatically adds the bits plus trailing zero bits
-			Tools::outputBits(dest, destIndex, buffer, availableBits, true);
+		}
+	}
+	//link the nodes of the cheapest path forwards, reusing the match length as link
+	for (int32_t i = labSize; i > 0; i = nodes[i].from)
+	{
+		nodes[nodes[i].from].matchLength = i;
+	}
+	//matches at the end of the LAB are cut short, so only encode messages starting before that, except when the input ends
+	const int32_t encodeEnd = labSize < m_lookAheadSize ? labSize : std::max(1, labSize - m_matchLengthMax);
+	int32_t i = 0;
+	while (i < encodeEnd)
+	{
+		const int32_t next = nodes[i].matchLength;
+		outputMessage(nodes[next].message, labStart + i, data, base, reps, dest, destIndex, buffer, bufferBits);
+		i = next;
+	}
+	return i;
+}
+
+size_t LZSS::encodeChunk(const uint8_t * data, int64_t start, int64_t end, LZMatchFinder & matchFinder, ParseNode * nodes, uint8_t * dest) const
+{
+	size_t destIndex = 0;
+	//the dictionary holds the data before start. add it to the match finder when encoding the first message
+	matchFinder.reset(dictionaryStart(start));
+	RepDistances reps = {};
+	int64_t labStart = start;
+	uint32_t buffer = 0; //bit buffer holding encoded data
+	uint32_t availableBits = 32; //number of available bits in buffer we can fill with data
+	while (labStart < end)
+	{
+		//calculate next look-ahead buffer size. this is usually m_lookAheadSize, but can be less at the end of the data.
+		const int32_t labSize = labStart + m_lookAheadSize > end ? static_cast<int32_t>(end - labStart) : m_lookAheadSize;
+		//encode symbols from look-ahead buffer and advance LAB
+		labStart += encodeMessages(data, 0, labStart, labSize, matchFinder, nodes, reps, dest, destIndex, buffer, availableBits);
+	}
+	//now if we still have remaining bits, dump buffer byte, which automatically adds the bits plus trailing zero bits
+	Tools::outputBits(dest, destIndex, buffer, availableBits, true);
+	return destIndex;
+}
+
+bool LZSS::decodeMessages(const uint8_t * source, size_t size, uint8_t * dest, size_t destIndex, size_t destEnd, int32_t dictionaryBits, int32_t matchLengthBits, bool repMatches)
+{
+	const uint8_t * in = source;
+	const uint8_t * inEnd = source + size;
+	uint8_t * out = dest + destIndex;
+	uint8_t * outEnd = dest + destEnd;
+	const size_t dictionarySize = (size_t(1) << dictionaryBits);
+	// calculate the minimum match. we need to add this to the encoded match length
+	const uint32_t matchLengthMin = ((dictionaryBits + matchLengthBits + 7) / 8) + 1;
+	const uint32_t matchLengthMax = ((1 << matchLengthBits) - 1) + matchLengthMin;
+	// with rep matches, the leading 1 is followed by a 0 for a match or a 1 for a rep match
+	const uint32_t matchFlagBits = repMatches ? 2 : 1;
+	const uint32_t matchBits = matchFlagBits + dictionaryBits + matchLengthBits;
+	const uint32_t repMatchBits = 4 + matchLengthBits;
+	const uint64_t indexMask = dictionarySize - 1;
+	const uint64_t lengthMask = (uint64_t(1) << matchLengthBits) - 1;
+	// recent match distances, most recent first. 0 if unused
+	size_t reps[RepCount] = {};
+	//bits are read from the top of the buffer. a message has at most 30 bits, so after a refill we always have enough
+	uint64_t buffer = 0;
+	uint32_t bits = 0;
+	// fast loop: refill by loading 8 bytes at once and copy in chunks that may write past the end of a match.
+	// this is only done while there is enough room for the longest match plus the chunk size in dest
+	while (inEnd - in >= 8 && outEnd - out >= static_cast<ptrdiff_t>(matchLengthMax + 16))
+	{
+		buffer |= Tools::readBigEndian64(in) >> bits;
+		in += (63 - bits) >> 3;
+		bits |= 56;
+		// check first bit (encoded / un-encoded)
+		if (buffer >> 63)
+		{
+			const size_t position = static_cast<size_t>(out - dest);
+			size_t offset = 0;
+			size_t stringLength = 0;
+			if (repMatches && ((buffer >> 62) & 1))
+			{
+				// bits are 11. get rep index and length bits and move the distance to the front
+				const uint32_t repIndex = static_cast<uint32_t>((buffer >> 60) & 3);
+				stringLength = static_cast<size_t>((buffer >> (64 - repMatchBits)) & lengthMask) + matchLengthMin;
+				buffer <<= repMatchBits;
+				bits -= repMatchBits;
+				offset = reps[repIndex];
+				if (offset == 0 || offset > position)
+				{
+					return false;
+				}
+				for (uint32_t i = repIndex; i > 0; --i)
+				{
+					reps[i] = reps[i - 1];
+				}
+			}
+			else
+			{
+				// bit is 1 (or bits are 10). get string index and length bits
+				const size_t stringIndex = static_cast<size_t>((buffer >> (64 - matchFlagBits - dictionaryBits)) & indexMask);
+				stringLength = static_cast<size_t>((buffer >> (64 - matchBits)) & lengthMask) + matchLengthMin;
+				buffer <<= matchBits;
+				bits -= matchBits;
+				// the index is relative to the start of the dictionary
+				const size_t matchPosition = (position <= dictionarySize ? 0 : position - dictionarySize) + stringIndex;
+				if (matchPosition >= position)
+				{
+					return false;
+				}
+				offset = position - matchPosition;
+				for (uint32_t i = RepCount - 1; i > 0; --i)
+				{
+					reps[i] = reps[i - 1];
+				}
+			}
+			reps[0] = offset;
+			out = Tools::copyMatch(out, offset, stringLength, outEnd);
+		}
+		else
+		{
+			// bit is 0. copy following symbol bits verbatim
+			*out++ = static_cast<uint8_t>(buffer >> 55);
+			buffer <<= 9;
+			bits -= 9;
+		}
+	}
+	// safe loop: refill byte by byte and copy byte by byte until dest is full
+	while (out < outEnd)
+	{
+		while (bits <= 56 && in < inEnd)
+		{
+			buffer |= static_cast<uint64_t>(*in++) << (56 - bits);
+			bits += 8;
+		}
+		// matches can be shorter than verbatim symbols, so check if we have enough bits for the message
+		const bool isEncoded = (buffer >> 63) != 0;
+		const bool isRepMatch = isEncoded && repMatches && ((buffer >> 62) & 1) != 0;
+		if (bits == 0 || bits < (isEncoded ? (isRepMatch ? repMatchBits : matchBits) : 9))
+		{
+			return false;
+		}
+		if (isEncoded)
+		{
+			const size_t position = static_cast<size_t>(out - dest);
+			size_t offset = 0;
+			size_t stringLength = 0;
+			if (isRepMatch)
+			{
+				const uint32_t repIndex = static_cast<uint32_t>((buffer >> 60) & 3);
+				stringLength = static_cast<size_t>((buffer >> (64 - repMatchBits)) & lengthMask) + matchLengthMin;
+				buffer <<= repMatchBits;
+				bits -= repMatchBits;
+				offset = reps[repIndex];
+				if (offset == 0 || offset > position)
+				{
+					return false;
+				}
+				for (uint32_t i = repIndex; i > 0; --i)
+				{
+					reps[i] = reps[i - 1];
+				}
+			}
+			else
+			{
+				const size_t stringIndex = static_cast<size_t>((buffer >> (64 - matchFlagBits - dictionaryBits)) & indexMask);
+				stringLength = static_cast<size_t>((buffer >> (64 - matchBits)) & lengthMask) + matchLengthMin;
+				buffer <<= matchBits;
+				bits -= matchBits;
+				const size_t matchPosition = (position <= dictionarySize ? 0 : position - dictionarySize) + stringIndex;
+				if (matchPosition >= position)
+				{
+					return false;
+				}
+				offset = position - matchPosition;
+				for (uint32_t i = RepCount - 1; i > 0; --i)
+				{
+					reps[i] = reps[i - 1];
+				}
+			}
+			reps[0] = offset;
+			if (stringLength > static_cast<size_t>(outEnd - out))
+			{
+				return false;
+			}
+			const uint8_t * match = out - offset;
+			for (size_t i = 0; i < stringLength; ++i)
+			{
+				*out++ = *match++;
+			}
+		}
+		else
+		{
+			*out++ = static_cast<uint8_t>(buffer >> 55);
+			buffer <<= 9;
+			bits -= 9;
+		}
+	}
+	return true;
+}
+
+size_t LZSS::encodeBound(size_t size) const
+{
+	//size + parameters + 9 bits per symbol + remaining bits in bit buffer
+	if (m_chunkSize > 0)
+	{
+		//+ chunk parameters + dictionary checksum + compressed chunk size and remaining bits for every chunk
+		const size_t nrOfChunks = (size + m_chunkSize - 1) / m_chunkSize;
+		return Tools::MaxSizeBytes + 7 + (m_dictionary ? 4 : 0) + size + (size + 7) / 8 + 9 * nrOfChunks;
+	}
+	//+ dictionary checksum
+	return Tools::MaxSizeBytes + 2 + (m_dictionary ? 4 : 0) + size + (size + 7) / 8 + 4;
+}
+
+size_t LZSS::encodeInto(const uint8_t * source, size_t size, uint8_t * dest, size_t destSize, Workspace & workspace) const
+{
+	const int64_t srcSize = static_cast<int64_t>(size);
+	if (srcSize > 0 && destSize >= encodeBound(size))
+	{
+		if (m_chunkSize > 0)
+		{
+			return encodeChunks(source, size, dest, workspace);
+		}
+		size_t destIndex = 0;
+		//output source size
+		Tools::writeSize(dest, destIndex, srcSize);
+		//store dictionary bits with flags and match length bits
+		const bool presetDictionary = m_dictionary && !m_dictionary->empty();
+		dest[destIndex++] = static_cast<uint8_t>(m_dictionaryBits) | (m_repMatches ? RepMatchFlag : 0) | (presetDictionary ? PresetDictionaryFlag : 0);
+		dest[destIndex++] = static_cast<uint8_t>(m_matchLengthBits);
+		if (presetDictionary)
+		{
+			//store the dictionary checksum, so decoding with a different dictionary fails
+			*((uint32_t *)&dest[destIndex]) = m_dictionaryChecksum;
+			destIndex += 4;
+			//the end of the dictionary fills the dictionary, so all source data can be encoded as messages
+			const int64_t presetSize = static_cast<int64_t>(std::min<size_t>(m_dictionary->size(), m_dictionarySize));
+			uint8_t * data = workspace.get<uint8_t>(3, presetSize + size);
+			std::copy(m_dictionary->cend() - presetSize, m_dictionary->cend(), data);
+			std::copy(source, source + size, data + presetSize);
+			LZMatchFinder matchFinder(workspace.get<int64_t>(0, size_t(1) << hashBits()), hashBits(), workspace.get<int64_t>(1, m_dictionarySize), m_dictionarySize, m_matchLengthMin, m_maxChainLength);
+			ParseNode * nodes = workspace.get<ParseNode>(2, m_lookAheadSize + 1);
+			destIndex += encodeChunk(data, presetSize, presetSize + srcSize, matchFinder, nodes, dest + destIndex);
+		}
+		//check if source size is bigger that look-ahead buffer size
+		else if (srcSize > m_lookAheadSize)
+		{
+			//set up match finder for dictionary and storage for optimal parsing
+			LZMatchFinder matchFinder(workspace.get<int64_t>(0, size_t(1) << hashBits()), hashBits(), workspace.get<int64_t>(1, m_dictionarySize), m_dictionarySize, m_matchLengthMin, m_maxChainLength);
+			ParseNode * nodes = workspace.get<ParseNode>(2, m_lookAheadSize + 1);
+			//push m_lookAheadSize bytes straight to output and move look-ahead buffer to next block
+			std::copy(source, source + m_lookAheadSize, dest + destIndex);
+			destIndex += m_lookAheadSize;
+			//do LZSS encoding
+			destIndex += encodeChunk(source, m_lookAheadSize, srcSize, matchFinder, nodes, dest + destIndex);
 		}
 		else
 		{
 			//source size is too small, do simple copy
-			std::copy(source.cbegin(), source.cend(), std::next(dest.begin(), destIndex));
+			std::copy(source, source + srcSize, dest + destIndex);
 			destIndex += srcSize;
 		}
-		dest.resize(destIndex);
-		return dest;
+		return destIndex;
+	}
+	return 0;
+}
+
+size_t LZSS::encodeChunks(const uint8_t * source, size_t size, uint8_t * dest, Workspace & workspace) const
+{
+	size_t destIndex = 0;
+	//output source size, dictionary bits with flags, match length bits, dictionary checksum, chunk flags and chunk size
+	Tools::writeSize(dest, destIndex, size);
+	const bool presetDictionary = m_dictionary && !m_dictionary->empty();
+	dest[destIndex++] = static_cast<uint8_t>(m_dictionaryBits) | ChunkedFlag | (m_repMatches ? RepMatchFlag : 0) | (presetDictionary ? PresetDictionaryFlag : 0);
+	dest[destIndex++] = static_cast<uint8_t>(m_matchLengthBits);
+	if (presetDictionary)
+	{
+		*((uint32_t *)&dest[destIndex]) = m_dictionaryChecksum;
+		destIndex += 4;
+	}
+	dest[destIndex++] = m_chunkDictionary ? ChunkDictionaryFlag : 0;
+	*((uint32_t *)&dest[destIndex]) = m_chunkSize;
+	destIndex += 4;
+	//chunks are encoded in parallel to a slot of their maximum size after the chunk table and moved together afterwards
+	const size_t nrOfChunks = (size + m_chunkSize - 1) / m_chunkSize;
+	uint32_t * chunkTable = (uint32_t *)&dest[destIndex];
+	destIndex += 4 * nrOfChunks;
+	const size_t chunksStart = destIndex;
+	const size_t slotSize = m_chunkSize + (m_chunkSize + 7) / 8 + 4;
+	const uint32_t nrOfThreads = Tools::parallelThreadCount(static_cast<uint32_t>(std::min<uint64_t>(threadCount(), nrOfChunks)), threadCount());
+	if (m_verbose && nrOfThreads > 1) { std::cout << "Encoding " << nrOfChunks << " LZSS chunk(s) using " << nrOfThreads << " thread(s)." << std::endl; }
+	//match finder and parsing storage for every thread
+	std::vector<int64_t *> heads(nrOfThreads);
+	std::vector<int64_t *> chains(nrOfThreads);
+	std::vector<ParseNode *> nodes(nrOfThreads);
+	for (uint32_t item = 0; item < nrOfThreads; ++item)
+	{
+		heads[item] = workspace.get<int64_t>(3 * item, size_t(1) << hashBits());
+		chains[item] = workspace.get<int64_t>(3 * item + 1, m_dictionarySize);
+		nodes[item] = workspace.get<ParseNode>(3 * item + 2, m_lookAheadSize + 1);
+	}
+	//the end of the preset dictionary goes in front of the first chunk, or in front of every chunk if chunks are independent
+	const int64_t presetSize = presetDictionary ? static_cast<int64_t>(std::min<size_t>(m_dictionary->size(), m_dictionarySize)) : 0;
+	uint8_t * presetData = nullptr;
+	std::vector<uint8_t *> chunkData(nrOfThreads, nullptr);
+	if (presetDictionary && m_chunkDictionary)
+	{
+		presetData = workspace.get<uint8_t>(3 * nrOfThreads, presetSize + size);
+		std::copy(m_dictionary->cend() - presetSize, m_dictionary->cend(), presetData);
+		std::copy(source, source + size, presetData + presetSize);
+	}
+	else if (presetDictionary)
+	{
+		for (uint32_t item = 0; item < nrOfThreads; ++item)
+		{
+			chunkData[item] = workspace.get<uint8_t>(3 * nrOfThreads + item, presetSize + m_chunkSize);
+			std::copy(m_dictionary->cend() - presetSize, m_dictionary->cend(), chunkData[item]);
+		}
+	}
+	//work item n encodes chunks n, n + nrOfThreads, n + 2 * nrOfThreads... using storage n
+	Tools::parallelFor(nrOfThreads, nrOfThreads, [&](uint32_t item, uint32_t /*threadIndex*/)
+	{
+		LZMatchFinder matchFinder(heads[item], hashBits(), chains[item], m_dictionarySize, m_matchLengthMin, m_maxChainLength);
+		for (size_t chunkIndex = item; chunkIndex < nrOfChunks; chunkIndex += nrOfThreads)
+		{
+			const int64_t chunkStart = static_cast<int64_t>(chunkIndex * m_chunkSize);
+			const int64_t chunkEnd = std::min<int64_t>(chunkStart + m_chunkSize, size);
+			uint8_t * slot = dest + chunksStart + chunkIndex * slotSize;
+			//with a chunk dictionary positions are relative to the source, so the end of the previous chunk is the dictionary
+			if (m_chunkDictionary)
+			{
+				chunkTable[chunkIndex] = static_cast<uint32_t>(presetDictionary ?
+					encodeChunk(presetData, presetSize + chunkStart, presetSize + chunkEnd, matchFinder, nodes[item], slot) :
+					encodeChunk(source, chunkStart, chunkEnd, matchFinder, nodes[item], slot));
+			}
+			else if (presetDictionary)
+			{
+				std::copy(source + chunkStart, source + chunkEnd, chunkData[item] + presetSize);
+				chunkTable[chunkIndex] = static_cast<uint32_t>(encodeChunk(chunkData[item], presetSize, presetSize + chunkEnd - chunkStart, matchFinder, nodes[item], slot));
+			}
+			else
+			{
+				chunkTable[chunkIndex] = static_cast<uint32_t>(encodeChunk(source + chunkStart, 0, chunkEnd - chunkStart, matchFinder, nodes[item], slot));
+			}
+		}
+	});
+	//move chunks together. they only move towards the start
+	for (size_t chunkIndex = 0; chunkIndex < nrOfChunks; ++chunkIndex)
+	{
+		std::memmove(dest + destIndex, dest + chunksStart + chunkIndex * slotSize, chunkTable[chunkIndex]);
+		destIndex += chunkTable[chunkIndex];
 	}
-	return std::vector<uint8_t>();
+	return destIndex;
+}
+
+size_t LZSS::decodedSize(const uint8_t * source, size_t size) const
+{
+	size_t srcIndex = 0;
+	uint64_t destSize = 0;
+	return Tools::readSize(source, size, srcIndex, destSize) ? static_cast<size_t>(destSize) : 0;
 }
 
-std::vector<uint8_t> LZSS::decode(const std::vector<uint8_t> & source) const
+size_t LZSS::decodeInto(const uint8_t * source, size_t size, uint8_t * dest, size_t destCapacity, Workspace & workspace) const
 {
-	const uint32_t srcSize = static_cast<uint32_t>(source.size());
-	if (srcSize > 0)
-	{
-		// read result size
-		uint32_t srcIndex = 0;
-		const uint32_t destSize = *((uint32_t *)&source[srcIndex]);
-		srcIndex += 4;
-		// allocate destination data
-		std::vector<uint8_t> dest(destSize);
-		uint32_t destIndex = 0;
+	const size_t srcSize = size;
+	// read result size
+	size_t srcIndex = 0;
+	uint64_t destSize = 0;
+	if (Tools::readSize(source, srcSize, srcIndex, destSize) && destSize <= destCapacity && srcIndex + 2 <= srcSize)
+	{
 		// read match dictionary bits and length bits
-		const int32_t dictionaryBits = source[srcIndex++];
+		const int32_t dictionaryBits = source[srcIndex] & ~(ChunkedFlag | RepMatchFlag | PresetDictionaryFlag);
+		const bool isChunked = (source[srcIndex] & ChunkedFlag) != 0;
+		const bool repMatches = (source[srcIndex] & RepMatchFlag) != 0;
+		const bool presetDictionary = (source[srcIndex++] & PresetDictionaryFlag) != 0;
 		const int32_t matchLengthBits = source[srcIndex++];
-		// calculate dictionary and look-ahead-buffer size
-		const int32_t dictionarySize = (1 << dictionaryBits);
+		if (dictionaryBits < 4 || dictionaryBits > 20 || matchLengthBits < 3 || matchLengthBits > 8)
+		{
+			return 0;
+		}
+		if (presetDictionary)
+		{
+			//the data must have been encoded with the same dictionary
+			if (srcIndex + 4 > srcSize || !m_dictionary || m_dictionary->empty() || *((const uint32_t *)&source[srcIndex]) != m_dictionaryChecksum)
+			{
+				if (m_verbose) std::cout << "LZSS data was encoded with a different dictionary!" << std::endl;
+				return 0;
+			}
+			srcIndex += 4;
+		}
+		if (isChunked)
+		{
+			return decodeChunks(source, srcSize, srcIndex, dest, static_cast<size_t>(destSize), dictionaryBits, matchLengthBits, repMatches, presetDictionary, workspace) ? static_cast<size_t>(destSize) : 0;
+		}
+		if (presetDictionary)
+		{
+			//decode after the end of the dictionary and move the result to dest
+			const size_t presetSize = std::min<size_t>(m_dictionary->size(), size_t(1) << dictionaryBits);
+			uint8_t * data = workspace.get<uint8_t>(0, presetSize + static_cast<size_t>(destSize));
+			std::copy(m_dictionary->cend() - presetSize, m_dictionary->cend(), data);
+			if (!decodeMessages(source + srcIndex, srcSize - srcIndex, data, presetSize, presetSize + static_cast<size_t>(destSize), dictionaryBits, matchLengthBits, repMatches))
+			{
+				return 0;
+			}
+			std::copy(data + presetSize, data + presetSize + destSize, dest);
+			return static_cast<size_t>(destSize);
+		}
+		// calculate look-ahead-buffer size
 		const int32_t lookAheadSize = (1 << (dictionaryBits - 3)); //look-ahead buffer size is 1/8 of dictionary size
 		// check if the source size is bigger than the look-ahead-buffer size
-		if (destSize > lookAheadSize)
+		if (destSize > static_cast<uint64_t>(lookAheadSize))
 		{
-			// calculate the minimum match. we need to add this to the encoded match length
-			const int32_t matchLengthMin = ((dictionaryBits + matchLengthBits + 7) / 8) + 1;
-			// check what the minimum amount of bits per message is (encoded or un-encoded)
-			const int32_t minCodeLength = 1 + std::min(dictionaryBits + matchLengthBits, 8);
 			// copy lookAheadSize symbols straight to the output / dictionary
-			std::copy(std::next(source.begin(), srcIndex), std::next(source.begin(), srcIndex + lookAheadSize), dest.begin());
-			destIndex += lookAheadSize;
+			if (srcIndex + lookAheadSize > srcSize)
+			{
+				return 0;
+			}
+			std::copy(source + srcIndex, source + srcIndex + lookAheadSize, dest);
 			srcIndex += lookAheadSize;
-			//apply reverse LZSS encoding
-			int32_t dictStart = 0;
-			uint32_t buffer = 0;
-			uint8_t availableBits = 32;
-			while ((destIndex < destSize) && (availableBits >= minCodeLength))
+			return decodeMessages(source + srcIndex, srcSize - srcIndex, dest, lookAheadSize, static_cast<size_t>(destSize), dictionaryBits, matchLengthBits, repMatches) ? static_cast<size_t>(destSize) : 0;
+		}
+		// source size is too small, do simple copy
+		if (srcIndex + destSize > srcSize)
+		{
+			return 0;
+		}
+		std::copy(source + srcIndex, source + srcIndex + destSize, dest);
+		return static_cast<size_t>(destSize);
+	}
+	return 0;
+}
+
+bool LZSS::decodeChunks(const uint8_t * source, size_t size, size_t srcIndex, uint8_t * dest, size_t destSize, int32_t dictionaryBits, int32_t matchLengthBits, bool repMatches, bool presetDictionary, Workspace & workspace) const
+{
+	// read chunk flags and size
+	if (srcIndex + 5 > size)
+	{
+		return false;
+	}
+	const bool chunkDictionary = (source[srcIndex++] & ChunkDictionaryFlag) != 0;
+	const uint32_t chunkSize = *((const uint32_t *)&source[srcIndex]);
+	srcIndex += 4;
+	if (chunkSize == 0)
+	{
+		return false;
+	}
+	// read chunk table and calculate where chunks start
+	const size_t nrOfChunks = (destSize + chunkSize - 1) / chunkSize;
+	if (nrOfChunks > (size - srcIndex) / 4)
+	{
+		return false;
+	}
+	const uint32_t * chunkTable = (const uint32_t *)&source[srcIndex];
+	srcIndex += 4 * nrOfChunks;
+	size_t * chunkOffsets = workspace.get<size_t>(0, nrOfChunks);
+	for (size_t chunkIndex = 0; chunkIndex < nrOfChunks; ++chunkIndex)
+	{
+		if (chunkTable[chunkIndex] > size - srcIndex)
+		{
+			return false;
+		}
+		chunkOffsets[chunkIndex] = srcIndex;
+		srcIndex += chunkTable[chunkIndex];
+	}
+	// chunks with a dictionary need the end of the previous chunk, so they are decoded one after another
+	const uint32_t nrOfThreads = chunkDictionary ? 1 : Tools::parallelThreadCount(static_cast<uint32_t>(std::min<uint64_t>(threadCount(), nrOfChunks)), threadCount());
+	if (m_verbose && nrOfThreads > 1) { std::cout << "Decoding " << nrOfChunks << " LZSS chunk(s) using " << nrOfThreads << " thread(s)." << std::endl; }
+	//with a preset dictionary, chunks are decoded behind the end of the dictionary and moved to dest
+	const size_t presetSize = presetDictionary ? std::min<size_t>(m_dictionary->size(), size_t(1) << dictionaryBits) : 0;
+	uint8_t * presetData = nullptr;
+	std::vector<uint8_t *> chunkData(nrOfThreads, nullptr);
+	if (presetDictionary && chunkDictionary)
+	{
+		presetData = workspace.get<uint8_t>(1, presetSize + destSize);
+		std::copy(m_dictionary->cend() - presetSize, m_dictionary->cend(), presetData);
+	}
+	else if (presetDictionary)
+	{
+		for (uint32_t item = 0; item < nrOfThreads; ++item)
+		{
+			chunkData[item] = workspace.get<uint8_t>(1 + item, presetSize + std::min<size_t>(chunkSize, destSize));
+			std::copy(m_dictionary->cend() - presetSize, m_dictionary->cend(), chunkData[item]);
+		}
+	}
+	std::atomic<bool> chunksValid(true);
+	//work item n decodes chunks n, n + nrOfThreads, n + 2 * nrOfThreads...
+	Tools::parallelFor(nrOfThreads, nrOfThreads, [&](uint32_t item, uint32_t /*threadIndex*/)
+	{
+		for (size_t chunkIndex = item; chunkIndex < nrOfChunks; chunkIndex += nrOfThreads)
+		{
+			const size_t chunkStart = chunkIndex * chunkSize;
+			const size_t chunkEnd = std::min<size_t>(chunkStart + chunkSize, destSize);
+			const uint8_t * chunk = source + chunkOffsets[chunkIndex];
+			bool chunkValid = false;
+			if (chunkDictionary)
+			{
+				chunkValid = presetDictionary ?
+					decodeMessages(chunk, chunkTable[chunkIndex], presetData, presetSize + chunkStart, presetSize + chunkEnd, dictionaryBits, matchLengthBits, repMatches) :
+					decodeMessages(chunk, chunkTable[chunkIndex], dest, chunkStart, chunkEnd, dictionaryBits, matchLengthBits, repMatches);
+			}
+			else if (presetDictionary)
+			{
+				chunkValid = decodeMessages(chunk, chunkTable[chunkIndex], chunkData[item], presetSize, presetSize + chunkEnd - chunkStart, dictionaryBits, matchLengthBits, repMatches);
+				std::copy(chunkData[item] + presetSize, chunkData[item] + presetSize + (chunkEnd - chunkStart), dest + chunkStart);
+			}
+			else
+			{
+				chunkValid = decodeMessages(chunk, chunkTable[chunkIndex], dest + chunkStart, 0, chunkEnd - chunkStart, dictionaryBits, matchLengthBits, repMatches);
+			}
+			if (!chunkValid)
+			{
+				chunksValid = false;
+			}
+		}
+	});
+	if (presetData && chunksValid)
+	{
+		std::copy(presetData + presetSize, presetData + presetSize + destSize, dest);
+	}
+	return chunksValid;
+}
+
+//------------------------------------------------------------------------------------------------
+
+/// @brief Incremental LZSS encoder. Keeps the dictionary and look-ahead buffer of the input in a sliding window.
+class LZSSEncodeStream : public I_CodecStream
+{
+public:
+	LZSSEncodeStream(const LZSS & codec, uint64_t sourceSize)
+		: m_codec(codec), m_sourceSize(sourceSize), m_head(size_t(1) << codec.hashBits()), m_chain(codec.m_dictionarySize)
+		, m_matchFinder(m_head.data(), codec.hashBits(), m_chain.data(), codec.m_dictionarySize, codec.m_matchLengthMin, codec.m_maxChainLength)
+		, m_nodes(codec.m_lookAheadSize + 1), m_encoded((codec.m_lookAheadSize * 9 + 7) / 8 + 4)
+	{
+	}
+
+	virtual bool push(const uint8_t * data, size_t size, std::vector<uint8_t> & output) override
+	{
+		if (m_position + size > m_sourceSize)
+		{
+			return false;
+		}
+		if (m_position == 0 && size > 0)
+		{
+			//output source size, dictionary bits and match length bits
+			std::vector<uint8_t> header(Tools::MaxSizeBytes + 2);
+			size_t headerIndex = 0;
+			Tools::writeSize(header.data(), headerIndex, m_sourceSize);
+			header[headerIndex++] = static_cast<uint8_t>(m_codec.m_dictionaryBits) | (m_codec.m_repMatches ? LZSS::RepMatchFlag : 0);
+			header[headerIndex++] = static_cast<uint8_t>(m_codec.m_matchLengthBits);
+			output.insert(output.end(), header.cbegin(), std::next(header.cbegin(), headerIndex));
+		}
+		//the first m_lookAheadSize bytes are stored verbatim. if the source size is too small, all bytes are
+		const uint64_t verbatimSize = m_sourceSize > static_cast<uint64_t>(m_codec.m_lookAheadSize) ? m_codec.m_lookAheadSize : m_sourceSize;
+		if (m_position < verbatimSize)
+		{
+			const size_t count = static_cast<size_t>(std::min<uint64_t>(size, verbatimSize - m_position));
+			output.insert(output.end(), data, data + count);
+		}
+		m_position += size;
+		if (verbatimSize < m_sourceSize)
+		{
+			m_window.insert(m_window.end(), data, data + size);
+			if (m_labStart == 0)
+			{
+				m_labStart = verbatimSize;
+			}
+			encodeWindow(output);
+		}
+		return true;
+	}
+
+	virtual bool finish(std::vector<uint8_t> & output) override
+	{
+		if (m_position != m_sourceSize)
+		{
+			return false;
+		}
+		if (m_labStart > 0)
+		{
+			//now if we still have remaining bits, dump buffer byte, which automatically adds the bits plus trailing zero bits
+			size_t destIndex = 0;
+			Tools::outputBits(m_encoded.data(), destIndex, m_buffer, m_availableBits, true);
+			output.insert(output.end(), m_encoded.cbegin(), std::next(m_encoded.cbegin(), destIndex));
+			m_labStart = 0;
+		}
+		return true;
+	}
+
+private:
+	/// @brief Encode as many messages as the input in the window allows. A message is only encoded when its full look-ahead buffer is available.
+	void encodeWindow(std::vector<uint8_t> & output)
+	{
+		const uint64_t windowEnd = m_windowStart + m_window.size();
+		while (m_labStart < m_sourceSize)
+		{
+			//calculate next look-ahead buffer size. this is usually m_lookAheadSize, but can be less at the end of the file.
+			const int32_t labSize = static_cast<int32_t>(std::min<uint64_t>(m_codec.m_lookAheadSize, m_sourceSize - m_labStart));
+			if (m_labStart + labSize > windowEnd)
+			{
+				break;
+			}
+			size_t destIndex = 0;
+			m_labStart += m_codec.encodeMessages(m_window.data(), m_windowStart, m_labStart, labSize, m_matchFinder, m_nodes.data(), m_reps, m_encoded.data(), destIndex, m_buffer, m_availableBits);
+			output.insert(output.end(), m_encoded.cbegin(), std::next(m_encoded.cbegin(), destIndex));
+		}
+		//remove data from the window that is not in the dictionary anymore
+		const uint64_t dictStart = m_labStart <= static_cast<uint64_t>(m_codec.m_dictionarySize) ? 0 : (m_labStart - m_codec.m_dictionarySize);
+		if (dictStart - m_windowStart >= static_cast<uint64_t>(m_codec.m_dictionarySize))
+		{
+			m_window.erase(m_window.begin(), std::next(m_window.begin(), static_cast<size_t>(dictStart - m_windowStart)));
+			m_windowStart = dictStart;
+		}
+	}
+
+	const LZSS & m_codec;
+	const uint64_t m_sourceSize;
+	uint64_t m_position = 0;
+	std::vector<uint8_t> m_window;
+	uint64_t m_windowStart = 0;
+	uint64_t m_labStart = 0;
+	std::vector<int64_t> m_head;
+	std::vector<int64_t> m_chain;
+	LZMatchFinder m_matchFinder;
+	std::vector<LZSS::ParseNode> m_nodes;
+	LZSS::RepDistances m_reps = {};
+	std::vector<uint8_t> m_encoded;
+	uint32_t m_buffer = 0;
+	uint32_t m_availableBits = 32;
+};
+
+/// @brief Incremental LZSS decoder. Keeps the dictionary of the output in a sliding window.
+class LZSSDecodeStream : public I_CodecStream
+{
+public:
+	LZSSDecodeStream(const LZSS & codec)
+		: m_codec(codec)
+	{
+	}
+
+	virtual bool push(const uint8_t * data, size_t size, std::vector<uint8_t> & output) override
+	{
+		for (size_t i = 0; i < size; ++i)
+		{
+			const uint8_t byte = data[i];
+			if (m_decodeInFinish)
+			{
+				// chunked data and data encoded with a dictionary is decoded in finish()
+				m_header.insert(m_header.end(), data + i, data + size);
+				return true;
+			}
+			else if (!m_headerRead)
+			{
+				//collect header bytes until we have the size, dictionary bits and match length bits
+				m_header.push_back(byte);
+				size_t index = 0;
+				uint64_t destSize = 0;
+				if (Tools::readSize(m_header.data(), m_header.size(), index, destSize) && index + 2 <= m_header.size())
+				{
+					m_destSize = destSize;
+					if (m_header[index] & (LZSS::ChunkedFlag | LZSS::PresetDictionaryFlag))
+					{
+						// chunked data and data encoded with a dictionary are not decoded incrementally. collect it, starting with the header
+						m_decodeInFinish = true;
+						continue;
+					}
+					m_repMatches = (m_header[index] & LZSS::RepMatchFlag) != 0;
+					m_dictionaryBits = m_header[index++] & ~LZSS::RepMatchFlag;
+					m_matchLengthBits = m_header[index++];
+					if (m_dictionaryBits < 4 || m_dictionaryBits > 20 || m_matchLengthBits < 3 || m_matchLengthBits > 8)
+					{
+						return false;
+					}
+					// calculate dictionary and look-ahead-buffer size and the minimum match
+					m_dictionarySize = (1 << m_dictionaryBits);
+					const uint64_t lookAheadSize = (1 << (m_dictionaryBits - 3));
+					m_matchLengthMin = ((m_dictionaryBits + m_matchLengthBits + 7) / 8) + 1;
+					// if the source size is smaller than the look-ahead-buffer size, all data is verbatim
+					m_verbatimSize = m_destSize > lookAheadSize ? lookAheadSize : m_destSize;
+					m_headerRead = true;
+					m_header.clear();
+				}
+			}
+			else if (m_destIndex < m_verbatimSize)
+			{
+				// copy symbols straight to the output / dictionary
+				outputSymbol(byte, output);
+			}
+			else
 			{
-				// fill buffer from input
-				while ((availableBits >= 8) && (srcIndex < srcSize))
+				// add byte to bit buffer and decode all messages that are complete
+				m_buffer |= static_cast<uint64_t>(byte) << (56 - m_bits);
+				m_bits += 8;
+				if (!decodeBuffer(output))
 				{
-					buffer |= source[srcIndex++] << (availableBits - 8);
-					availableBits -= 8;
+					return false;
 				}
-				const bool isEncoded = (bool)(buffer >> 31);
-				buffer <<= 1;
-				availableBits += 1;
-				// check first bit (encoded / un-encoded)
-				if (isEncoded)
+			}
+		}
+		trimHistory();
+		return true;
+	}
+
+	virtual bool finish(std::vector<uint8_t> & output) override
+	{
+		if (m_decodeInFinish)
+		{
+			const size_t outputSize = output.size();
+			output.resize(outputSize + static_cast<size_t>(m_destSize));
+			Workspace workspace;
+			return m_codec.decodeInto(m_header.data(), m_header.size(), output.data() + outputSize, static_cast<size_t>(m_destSize), workspace) == m_destSize;
+		}
+		//no input at all is fine, as encode() produces no output for empty data
+		if (!m_headerRead)
+		{
+			return m_header.empty();
+		}
+		return m_destIndex == m_destSize;
+	}
+
+private:
+	bool decodeBuffer(std::vector<uint8_t> & output)
+	{
+		while (m_destIndex < m_destSize && m_bits > 0)
+		{
+			// check first bit (encoded / un-encoded). matches can be shorter than a literal
+			const bool isEncoded = (bool)(m_buffer >> 63);
+			const bool isRepMatch = isEncoded && m_repMatches && ((m_buffer >> 62) & 1) != 0;
+			const uint32_t matchFlagBits = m_repMatches ? 2 : 1;
+			const uint32_t messageBits = isEncoded ? (isRepMatch ? 4 : matchFlagBits + m_dictionaryBits) + m_matchLengthBits : 9;
+			if (m_bits < messageBits)
+			{
+				break;
+			}
+			if (isEncoded)
+			{
+				const uint64_t stringLength = ((m_buffer >> (64 - messageBits)) & ((1 << m_matchLengthBits) - 1)) + m_matchLengthMin;
+				const uint64_t dictStart = m_destIndex <= m_dictionarySize ? 0 : (m_destIndex - m_dictionarySize);
+				uint64_t matchPosition = 0;
+				if (isRepMatch)
 				{
-					// bit is 1. get string index and length bits from source
-					const uint32_t stringIndex = buffer >> (32 - dictionaryBits);
-					buffer <<= dictionaryBits;
-					availableBits += dictionaryBits;
-					const uint32_t stringLength = (buffer >> (32 - matchLengthBits)) + matchLengthMin;
-					buffer <<= matchLengthBits;
-					availableBits += matchLengthBits;
-					// copy symbol string from dictionary
-					std::copy(std::next(dest.begin(), dictStart + stringIndex), std::next(dest.begin(), dictStart + stringIndex + stringLength), std::next(dest.begin(), destIndex));
-					destIndex += stringLength;
-					//std::string match(std::next(dest.begin(), dictStart + stringIndex), std::next(dest.begin(), dictStart + stringIndex + stringLength));
-					//std::cout << match << " -> match index " << stringIndex << ", length " << stringLength << std::endl;
+					// bits are 11. get the rep index and move its distance to the front
+					const uint32_t repIndex = static_cast<uint32_t>((m_buffer >> 60) & 3);
+					const uint64_t distance = m_reps[repIndex];
+					if (distance == 0 || distance > m_destIndex - dictStart)
+					{
+						return false;
+					}
+					matchPosition = m_destIndex - distance;
+					for (uint32_t i = repIndex; i > 0; --i)
+					{
+						m_reps[i] = m_reps[i - 1];
+					}
 				}
 				else
 				{
-					// bit is 0. copy following symbol bits verbatim
-					//std::cout << (uint8_t)(buffer >> 24) << " -> verbatim" << std::endl;
-					dest[destIndex++] = buffer >> 24;
-					buffer <<= 8;
-					availableBits += 8;
+					// bit is 1 (or bits are 10). get string index and push its distance to the front
+					matchPosition = dictStart + ((m_buffer >> (64 - matchFlagBits - m_dictionaryBits)) & (m_dictionarySize - 1));
+					if (matchPosition >= m_destIndex)
+					{
+						return false;
+					}
+					for (uint32_t i = LZSS::RepCount - 1; i > 0; --i)
+					{
+						m_reps[i] = m_reps[i - 1];
+					}
+				}
+				m_reps[0] = m_destIndex - matchPosition;
+				m_buffer <<= messageBits;
+				m_bits -= messageBits;
+				// copy symbol string from dictionary
+				if (m_destIndex + stringLength > m_destSize)
+				{
+					return false;
 				}
-				// advance dictionary
-				dictStart = (destIndex - dictStart) <= dictionarySize ? 0 : (destIndex - dictionarySize);
+				for (uint64_t i = 0; i < stringLength; ++i)
+				{
+					outputSymbol(m_history[static_cast<size_t>(matchPosition + i - m_historyStart)], output);
+				}
+			}
+			else
+			{
+				// bit is 0. copy following symbol bits verbatim
+				outputSymbol(static_cast<uint8_t>(m_buffer >> 55), output);
+				m_buffer <<= 9;
+				m_bits -= 9;
 			}
 		}
-		else
+		return true;
+	}
+
+	void outputSymbol(uint8_t symbol, std::vector<uint8_t> & output)
+	{
+		m_history.push_back(symbol);
+		output.push_back(symbol);
+		m_destIndex++;
+	}
+
+	void trimHistory()
+	{
+		//remove data from the history that is not in the dictionary anymore
+		const uint64_t dictStart = m_destIndex <= m_dictionarySize ? 0 : (m_destIndex - m_dictionarySize);
+		if (dictStart - m_historyStart >= m_dictionarySize)
 		{
-			// source size is too small, do simple copy
-			std::copy(std::next(source.cbegin(), srcIndex), source.cend(), dest.begin());
-			//destIndex += destSize;
+			m_history.erase(m_history.begin(), std::next(m_history.begin(), static_cast<size_t>(dictStart - m_historyStart)));
+			m_historyStart = dictStart;
 		}
-		return dest;
 	}
-	return std::vector<uint8_t>();
-}
\ No newline at end of file
+
+	const LZSS & m_codec;
+	std::vector<uint8_t> m_header;
+	bool m_headerRead = false;
+	bool m_decodeInFinish = false;
+	uint64_t m_destSize = 0;
+	uint64_t m_destIndex = 0;
+	uint64_t m_verbatimSize = 0;
+	uint32_t m_dictionaryBits = 0;
+	uint32_t m_matchLengthBits = 0;
+	uint64_t m_dictionarySize = 0;
+	uint32_t m_matchLengthMin = 0;
+	bool m_repMatches = false;
+	uint64_t m_reps[LZSS::RepCount] = {};
+	std::vector<uint8_t> m_history;
+	uint64_t m_historyStart = 0;
+	uint64_t m_buffer = 0;
+	uint32_t m_bits = 0;
+};
+
+I_CodecStream::SPtr LZSS::createEncodeStream(uint64_t sourceSize) const
+{
+	//the source size is stored in front of the data, so we need to know it. chunks and data with a dictionary are encoded when all data is there
+	if (sourceSize == 0 || m_chunkSize > 0 || m_dictionary)
+	{
+		return I_Codec::createEncodeStream(sourceSize);
+	}
+	return std::make_shared<LZSSEncodeStream>(*this, sourceSize);
+}
+
+I_CodecStream::SPtr LZSS::createDecodeStream() const
+{
+	return std::make_shared<LZSSDecodeStream>(*this);
+}
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "codec.h"
+#include "lz_matchfinder.h"
+#include <array>
 #include <inttypes.h>
 
 
@@ -10,6 +12,13 @@ public:
 	/// @brief Codec identifier. Do not change this and make sure there are no duplicate identifiers!
 	static const uint8_t CodecIdentifier;
 
+	/// @brief Lowest compression level. Fastest, greedy parsing checking a single match candidate.
+	static const uint32_t MinLevel;
+	/// @brief Highest compression level. Slowest, optimal parsing checking many match candidates.
+	static const uint32_t MaxLevel;
+	/// @brief Compression level used if none is set.
+	static const uint32_t DefaultLevel;
+
 	/// @brief Typedef for sharing a codec. Used in Compressor::compress().
 	typedef std::shared_ptr<LZSS> SPtr;
 
@@ -25,34 +34,217 @@ public:
 	/// @return Codec name.
 	virtual std::string codecName() const override;
 
-	/// @brief Set the dictionary size and maximum match length used for compression.
+	/// @brief Set the dictionary size, maximum match length and compression level used for compression.
+	/// The level only changes how hard the encoder searches. All levels produce data that decodes the same way:
+	/// - Levels 1-3 parse greedily, taking the longest match at the current position.
+	/// - Levels 4-7 parse lazily, emitting a verbatim byte if the next position has a longer match.
+	/// - Levels 8-9 parse optimally, choosing the messages with the fewest bits over the look-ahead buffer.
+	/// Higher levels also check more match candidates per position.
 	/// @param dictionaryBits How many bits to allocate for the dictionary [4,20].
 	/// @param matchLengthBits How many bits to allocate for length of the matched string [3,8].
-	void setCompressionParameters(const uint32_t dictionaryBits = 12, const uint32_t matchLengthBits = 4);
+	/// @param level Compression level [MinLevel,MaxLevel].
+	void setCompressionParameters(const uint32_t dictionaryBits = 12, const uint32_t matchLengthBits = 4, const uint32_t level = 6);
+
+	/// @brief Split the input into chunks that are encoded and decoded on multiple threads (see setThreadCount()).
+	/// Chunked data is stored in a different format with a table of the compressed chunk sizes in the header.
+	/// @param chunkSize Size of chunks in bytes. Pass 0 to encode all input as one stream.
+	/// @param chunkDictionary If true, chunks use the end of the previous chunk as dictionary. This compresses better,
+	/// but chunks must be decoded one after another. If false, chunks are independent and decoded in parallel.
+	void setChunkParameters(const uint32_t chunkSize = 0, const bool chunkDictionary = false);
+
+	/// @brief Select the data format. Rep matches are on by default and need a decoder that knows them.
+	/// @param repMatches If true, the last RepCount match distances are kept and a match at one of them is stored as
+	/// a short rep match. If false, the original format is written, in which every match stores a full dictionary index.
+	void setRepMatches(const bool repMatches = true);
+
+	/// @brief Number of recent match distances rep matches can refer to.
+	static const uint32_t RepCount = 4;
+
+	/// @brief Set data that fills the dictionary before encoding and decoding, e.g. trained with trainLZDictionary().
+	/// The last bytes of it, up to the dictionary size, are used. With it even input smaller than the look-ahead buffer
+	/// is encoded as messages, which is what makes small messages compress. Chunks start with the dictionary in front of them,
+	/// independent chunks every one of them, chunks using the previous chunk as dictionary only the first one.
+	/// @param dictionary Dictionary data. Pass nullptr to use no dictionary (the default).
+	virtual void setDictionary(std::shared_ptr<const std::vector<uint8_t>> dictionary) override;
+
+	/// @brief Worst-case size of the data encodeInto() produces with the current settings.
+	/// @param size Size of source data.
+	/// @return Returns the size of header data plus 9 bits per symbol for the worst case of no matches. Chunks add 9 bytes each.
+	virtual size_t encodeBound(size_t size) const override;
 
 	/// @brief Apply LZSS entropy encoding.
-	/// @param source Source data.
-	/// @return Returns compressed data.
-	/// @note This implementation uses 9/17 bits for un-encoded/encoded bytes and a dictionary of 4096 bytes per default.
+	/// This implementation uses 9/17 bits for un-encoded/encoded bytes and a dictionary of 4096 bytes per default.
 	/// The first bit is the un-encoded/encoded flag, then follows the data.
 	/// Un-encoded bytes are appended verbatim, whereas
 	/// encoded runs are split into a dictionary index of 12 bits and a run length of 4 bits.
 	/// Runs under 2 bytes are not encoded, thus the run length goes from 3 to 18 (0-15 binary).
 	/// The default values can be changed using setCompressionParameters() before encoding.
-	virtual std::vector<uint8_t> encode(const std::vector<uint8_t> & source) const override;
+	/// Matches are found with hash chains that check a number of candidates depending on the level, so encoding speed does not depend on the dictionary size.
+	/// The encoder needs 8 bytes per dictionary entry plus up to 512kB for the hash table.
+	/// If chunks are set, the dictionary bits have the top bit set and are followed by the match length bits, chunk flags,
+	/// the chunk size (4 bytes) and the compressed size of every chunk (4 bytes each), then all chunks.
+	/// Every chunk holds messages only, without verbatim data at the start.
+	/// With rep matches, the dictionary bits have bit 6 set. An encoded message then starts with "10" for a match with a
+	/// dictionary index, or with "11" for a rep match, followed by the index of the distance (2 bits) and the run length.
+	/// The distances are kept most recent first. A rep match moves its distance to the front, any other match pushes
+	/// its distance to the front. Every chunk starts without distances.
+	/// With a dictionary, the dictionary bits have bit 5 set and the match length bits are followed by the Adler-32 checksum
+	/// of the dictionary (4 bytes), then messages only, or the chunk flags if chunked. Positions count from the start of the part
+	/// of the dictionary used.
+	/// @param source Pointer to source data.
+	/// @param size Size of source data.
+	/// @param dest Pointer to destination buffer.
+	/// @param destSize Size of destination buffer. Must be at least encodeBound(size).
+	/// @param workspace Scratch memory reused across calls.
+	/// @return Number of bytes written to dest. 0 if encoding failed.
+	virtual size_t encodeInto(const uint8_t * source, size_t size, uint8_t * dest, size_t destSize, Workspace & workspace) const override;
+
+	/// @brief Size of the data decodeInto() produces.
+	/// @param source Pointer to compressed data.
+	/// @param size Size of compressed data.
+	/// @return Returns the size stored in the header of the compressed data. 0 if the size could not be determined.
+	virtual size_t decodedSize(const uint8_t * source, size_t size) const override;
 
 	/// @brief Apply reverse LZSS entropy encoding.
-	/// @param source Source data.
-	/// @return Returns decompressed data.
-	virtual std::vector<uint8_t> decode(const std::vector<uint8_t> & source) const override;
+	/// @param source Pointer to compressed data.
+	/// @param size Size of compressed data.
+	/// @param dest Pointer to destination buffer.
+	/// @param destSize Size of destination buffer. Must be at least decodedSize(source, size).
+	/// @param workspace Scratch memory reused across calls.
+	/// @return Number of bytes written to dest. 0 if decoding failed.
+	virtual size_t decodeInto(const uint8_t * source, size_t size, uint8_t * dest, size_t destSize, Workspace & workspace) const override;
+
+	/// @brief Create an incremental encoder producing the same output as encode().
+	/// Only the dictionary and look-ahead buffer are held in memory. Chunked output and output with a dictionary set is produced by encoding all input in finish().
+	/// @param sourceSize Total size of input. If 0 (unknown) all input is held until finish(), because the size is stored first.
+	/// @return Encoder stream.
+	virtual I_CodecStream::SPtr createEncodeStream(uint64_t sourceSize = 0) const override;
+
+	/// @brief Create an incremental decoder producing the same output as decode().
+	/// Only the dictionary is held in memory. Chunked data and data encoded with a dictionary is collected and decoded in finish().
+	/// @return Decoder stream.
+	virtual I_CodecStream::SPtr createDecodeStream() const override;
 
 private:
+	friend class LZSSEncodeStream;
+	friend class LZSSDecodeStream;
+
+	/// @brief How messages are chosen from the matches found.
+	enum class Parsing : uint8_t
+	{
+		Greedy = 0, ///< Take the longest match at the current position.
+		Lazy = 1, ///< Take the longest match, unless the next position has a longer one.
+		Optimal = 2 ///< Take the cheapest sequence of messages over the look-ahead buffer.
+	};
+
+	/// @brief Recent match distances, most recent first. 0 if unused.
+	typedef std::array<int64_t, RepCount> RepDistances;
+
+	/// @brief A message for a position. Matches either have a match position or refer to a rep distance.
+	struct Message
+	{
+		int32_t length; ///< Length of match. 1 for a verbatim byte.
+		int32_t repIndex; ///< Index of the rep distance used. -1 for a match with a dictionary index.
+		int64_t matchPosition; ///< Absolute position of the match.
+	};
+
+	/// @brief Match found for a position of the look-ahead buffer and cheapest way to get there. Used for optimal parsing.
+	struct ParseNode
+	{
+		int64_t matchPosition;
+		int32_t matchLength;
+		uint32_t cost;
+		int32_t from; ///< Node the cheapest message reaching this node starts at.
+		Message message; ///< Cheapest message reaching this node.
+		RepDistances reps; ///< Rep distances after the cheapest path to this node.
+	};
+
+	/// @brief Encode the next messages (matches or verbatim bytes) from the look-ahead buffer.
+	/// Depending on the parsing, one or more messages are encoded. The messages only depend on the look-ahead buffer and the dictionary.
+	/// @param data Pointer to source data at position base. Only the range [labStart - dictionary size, labStart + labSize) is accessed.
+	/// @param base Absolute position of data[0].
+	/// @param labStart Absolute position of start of look-ahead buffer. The dictionary ends here.
+	/// @param labSize Size of look-ahead buffer.
+	/// @param matchFinder Match finder for the dictionary. Positions up to the encoded end are added to it.
+	/// @param nodes Storage for optimal parsing of at least m_lookAheadSize + 1 entries.
+	/// @param reps Rep distances. Updated with the matches encoded.
+	/// @param dest Destination buffer. Must hold (labSize * 9 + 7) / 8 + 4 bytes.
+	/// @return Number of bytes encoded.
+	int32_t encodeMessages(const uint8_t * data, int64_t base, int64_t labStart, int32_t labSize, LZMatchFinder & matchFinder, ParseNode * nodes, RepDistances & reps, uint8_t * dest, size_t & destIndex, uint32_t & buffer, uint32_t & bufferBits) const;
+
+	/// @brief Find optimal messages for the look-ahead buffer and encode them.
+	int32_t encodeOptimal(const uint8_t * data, int64_t base, int64_t labStart, int32_t labSize, LZMatchFinder & matchFinder, ParseNode * nodes, RepDistances & reps, uint8_t * dest, size_t & destIndex, uint32_t & buffer, uint32_t & bufferBits) const;
+
+	/// @brief Find the message that saves the most bits at position. Rep distances are checked first. If one of them
+	/// gives the longest possible match, the dictionary is not searched.
+	Message findMessage(const uint8_t * data, int64_t base, int64_t position, int32_t maxLength, LZMatchFinder & matchFinder, const RepDistances & reps) const;
+
+	/// @brief Number of bits a message saves compared to verbatim bytes.
+	int32_t messageSavings(const Message & message) const;
+
+	/// @brief Output a message and update the rep distances.
+	void outputMessage(const Message & message, int64_t position, const uint8_t * data, int64_t base, RepDistances & reps, uint8_t * dest, size_t & destIndex, uint32_t & buffer, uint32_t & bufferBits) const;
+
+	/// @brief Update rep distances after a match of distance at repIndex (or -1 for a new distance).
+	static void updateReps(RepDistances & reps, int32_t repIndex, int64_t distance);
+
+	/// @brief Encode all messages for data in [start, end) to dest. The data before start is used as dictionary.
+	/// @return Number of bytes written to dest, including the last partial byte.
+	size_t encodeChunk(const uint8_t * data, int64_t start, int64_t end, LZMatchFinder & matchFinder, ParseNode * nodes, uint8_t * dest) const;
+
+	/// @brief Encode source in chunks on multiple threads, including the header.
+	/// @return Number of bytes written to dest.
+	size_t encodeChunks(const uint8_t * source, size_t size, uint8_t * dest, Workspace & workspace) const;
+
+	/// @brief Decode all messages in source to dest, from destIndex up to destEnd. The data before destIndex is used as dictionary.
+	/// While far enough from the end of source and dest, the bit buffer is refilled with single 8-byte loads and matches are
+	/// copied in 8/16-byte chunks that may write past their end. Near the end, bytes are read and copied one by one.
+	/// @return Returns true if exactly destEnd - destIndex bytes were decoded.
+	static bool decodeMessages(const uint8_t * source, size_t size, uint8_t * dest, size_t destIndex, size_t destEnd, int32_t dictionaryBits, int32_t matchLengthBits, bool repMatches);
+
+	/// @brief Decode chunked data after the dictionary and match length bits and the dictionary checksum in the header on multiple threads.
+	/// With presetDictionary, the end of the dictionary set with setDictionary() is put in front of the first or every chunk like when encoding.
+	/// @return Returns true if all chunks were decoded.
+	bool decodeChunks(const uint8_t * source, size_t size, size_t srcIndex, uint8_t * dest, size_t destSize, int32_t dictionaryBits, int32_t matchLengthBits, bool repMatches, bool presetDictionary, Workspace & workspace) const;
+
+	/// @brief Start of the dictionary for a message at position.
+	int64_t dictionaryStart(int64_t position) const;
+
+	/// @brief Number of hash bits the match finder uses for the current dictionary size.
+	uint32_t hashBits() const;
+
 	/// @brief Output a verbatim / un-encoded byte to dest.
-	void outputVerbatim(uint8_t symbol, std::vector<uint8_t> & dest, uint32_t & destIndex, uint32_t & buffer, uint32_t & bufferBits) const;
+	void outputVerbatim(uint8_t symbol, uint8_t * dest, size_t & destIndex, uint32_t & buffer, uint32_t & bufferBits) const;
 
 	/// @brief Output an encoded match to dest.
-	void outputMatch(int32_t index, int32_t length, std::vector<uint8_t> & dest, uint32_t & destIndex, uint32_t & buffer, uint32_t & bufferBits) const;
+	void outputMatch(int32_t index, int32_t length, uint8_t * dest, size_t & destIndex, uint32_t & buffer, uint32_t & bufferBits) const;
+
+	/// @brief Output a rep match to dest.
+	void outputRepMatch(int32_t repIndex, int32_t length, uint8_t * dest, size_t & destIndex, uint32_t & buffer, uint32_t & bufferBits) const;
+
+	/// @brief Set in the dictionary bits of the header if the data is chunked.
+	static const uint8_t ChunkedFlag;
+	/// @brief Set in the dictionary bits of the header if the data has rep matches.
+	static const uint8_t RepMatchFlag;
+	/// @brief Set in the dictionary bits of the header if the data was encoded with a dictionary.
+	static const uint8_t PresetDictionaryFlag;
+	/// @brief Set in the chunk flags of the header if chunks use the end of the previous chunk as dictionary.
+	static const uint8_t ChunkDictionaryFlag;
 
+	/// @brief Size of chunks. 0 if all input is encoded as one stream.
+	uint32_t m_chunkSize = 0;
+	/// @brief If true, chunks use the end of the previous chunk as dictionary.
+	bool m_chunkDictionary = false;
+	/// @brief If true, the format with rep matches is written.
+	bool m_repMatches = true;
+	/// @brief Adler-32 checksum of the dictionary data set.
+	uint32_t m_dictionaryChecksum = 0;
+	/// @brief Compression level.
+	uint32_t m_level = 6;
+	/// @brief Parsing used for the compression level.
+	Parsing m_parsing = Parsing::Lazy;
+	/// @brief Maximum number of match candidates checked per position for the compression level.
+	uint32_t m_maxChainLength = 256;
 	/// @brief Number of bits used for dictionary in encoded data.
 	int32_t m_dictionaryBits = 12;
 	/// @brief Size of dictionary.
@@ -21,18 +21,21 @@ Mtf1 * Mtf1::Create()
 	return new Mtf1();
 }
 
-std::vector<uint8_t> Mtf1::encode(const std::vector<uint8_t> & source) const
+size_t Mtf1::encodeBound(size_t size) const
 {
-	const uint32_t srcSize = static_cast<uint32_t>(source.size());
-	if (srcSize > 0)
+	return size;
+}
+
+size_t Mtf1::encodeInto(const uint8_t * source, size_t size, uint8_t * dest, size_t destSize, Workspace & /*workspace*/) const
+{
+	const size_t srcSize = size;
+	if (srcSize > 0 && destSize >= srcSize)
 	{
-		std::vector<uint8_t> dest(srcSize);
-		uint32_t destIndex = 0;
 		//set up symbol table
 		std::array<uint8_t, 256> symbols;
 		std::iota(symbols.begin(), symbols.end(), 0);
 		//apply MTF encoding
-		for (uint32_t i = 0; i < srcSize; ++i)
+		for (size_t i = 0; i < srcSize; ++i)
 		{
 			uint8_t symbol = source[i];
 			//find symbol in source
@@ -45,25 +48,26 @@ std::vector<uint8_t> Mtf1::encode(const std::vector<uint8_t> & source) const
 			while (newIndex < index) { symbols[index] = symbols[index - 1]; --index; }
 			symbols[newIndex] = symbol;
 		}
-		return dest;
+		return srcSize;
 	}
-	return std::vector<uint8_t>();
+	return 0;
+}
+
+size_t Mtf1::decodedSize(const uint8_t * /*source*/, size_t size) const
+{
+	return size;
 }
 
-std::vector<uint8_t> Mtf1::decode(const std::vector<uint8_t> & source) const
+size_t Mtf1::decodeInto(const uint8_t * source, size_t size, uint8_t * dest, size_t destSize, Workspace & /*workspace*/) const
 {
-	const uint32_t srcSize = static_cast<uint32_t>(source.size());
-	if (srcSize > 0)
+	const size_t srcSize = size;
+	if (srcSize > 0 && destSize >= srcSize)
 	{
-		uint32_t srcIndex = 0;
-		//allocate destination data
-		std::vector<uint8_t> dest(srcSize);
-		uint32_t destIndex = 0;
 		//set up symbol table
 		std::array<uint8_t, 256> symbols;
 		std::iota(symbols.begin(), symbols.end(), 0);
 		//apply MTF encoding
-		for (uint32_t i = 0; i < srcSize; ++i)
+		for (size_t i = 0; i < srcSize; ++i)
 		{
 			uint32_t index = source[i];
 			uint8_t symbol = symbols[index];
@@ -74,7 +78,64 @@ std::vector<uint8_t> Mtf1::decode(const std::vector<uint8_t> & source) const
 			while (newIndex < index) { symbols[index] = symbols[index - 1]; --index; }
 			symbols[newIndex] = symbol;
 		}
-		return dest;
+		return srcSize;
 	}
-	return std::vector<uint8_t>();
-}
\ No newline at end of file
+	return 0;
+}
+
+/// @brief Incremental move-to-front-1 encoder or decoder. Only needs to remember the symbol table.
+class Mtf1Stream : public I_CodecStream
+{
+public:
+	Mtf1Stream(bool encode)
+		: m_encode(encode)
+	{
+		std::iota(m_symbols.begin(), m_symbols.end(), 0);
+	}
+
+	virtual bool push(const uint8_t * data, size_t size, std::vector<uint8_t> & output) override
+	{
+		for (size_t i = 0; i < size; ++i)
+		{
+			uint32_t index = 0;
+			uint8_t symbol = data[i];
+			if (m_encode)
+			{
+				//find symbol in table and output index
+				while (m_symbols[index] != symbol) { ++index; }
+				output.push_back(index);
+			}
+			else
+			{
+				//look up symbol in table and output it
+				index = data[i];
+				symbol = m_symbols[index];
+				output.push_back(symbol);
+			}
+			//move symbol to position 0 if it was already at 1, else move it to 1
+			uint32_t newIndex = (index <= 1) ? 0 : 1;
+			while (newIndex < index) { m_symbols[index] = m_symbols[index - 1]; --index; }
+			m_symbols[newIndex] = symbol;
+		}
+		return true;
+	}
+
+	virtual bool finish(std::vector<uint8_t> & /*output*/) override
+	{
+		return true;
+	}
+
+private:
+	const bool m_encode;
+	std::array<uint8_t, 256> m_symbols;
+};
+
+I_CodecStream::SPtr Mtf1::createEncodeStream(uint64_t /*sourceSize*/) const
+{
+	return std::make_shared<Mtf1Stream>(true);
+}
+
+I_CodecStream::SPtr Mtf1::createDecodeStream() const
+{
+	return std::make_shared<Mtf1Stream>(false);
+}
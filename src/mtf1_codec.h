@@ -22,16 +22,44 @@ public:
 	/// @return Codec name.
 	virtual std::string codecName() const override;
 
+	/// @brief Worst-case size of the data encodeInto() produces with the current settings.
+	/// @param size Size of source data.
+	/// @return Returns size, as move-to-front encoding does not change the size of data.
+	virtual size_t encodeBound(size_t size) const override;
+
 	/// @brief Apply move-to-front encoding on data. This is actually the MTF-1 variant of the algorithm.
 	/// It moves a new symbol to the 0th entry only if it has already occurred directly before (is at index 1),
 	/// otherwise it moves it to entry 1 first.
-	/// @param source Source data.
-	/// @return Returns compressed data.
-	virtual std::vector<uint8_t> encode(const std::vector<uint8_t> & source) const override;
+	/// @param source Pointer to source data.
+	/// @param size Size of source data.
+	/// @param dest Pointer to destination buffer.
+	/// @param destSize Size of destination buffer. Must be at least encodeBound(size).
+	/// @param workspace Scratch memory reused across calls.
+	/// @return Number of bytes written to dest. 0 if encoding failed.
+	virtual size_t encodeInto(const uint8_t * source, size_t size, uint8_t * dest, size_t destSize, Workspace & workspace) const override;
+
+	/// @brief Size of the data decodeInto() produces.
+	/// @param source Pointer to compressed data.
+	/// @param size Size of compressed data.
+	/// @return Returns size, as move-to-front encoding does not change the size of data.
+	virtual size_t decodedSize(const uint8_t * source, size_t size) const override;
 
 	/// @brief Apply reverse move-to-front encoding on data. This is actually the MTF-1 variant of the algorithm.
-	/// @param source Source data.
-	/// @return Returns decompressed data.
-	virtual std::vector<uint8_t> decode(const std::vector<uint8_t> & source) const override;
+	/// @param source Pointer to compressed data.
+	/// @param size Size of compressed data.
+	/// @param dest Pointer to destination buffer.
+	/// @param destSize Size of destination buffer. Must be at least decodedSize(source, size).
+	/// @param workspace Scratch memory reused across calls.
+	/// @return Number of bytes written to dest. 0 if decoding failed.
+	virtual size_t decodeInto(const uint8_t * source, size_t size, uint8_t * dest, size_t destSize, Workspace & workspace) const override;
+
+	/// @brief Create an incremental encoder producing the same output as encode().
+	/// @param sourceSize Total size of input. Not needed for this codec.
+	/// @return Encoder stream.
+	virtual I_CodecStream::SPtr createEncodeStream(uint64_t sourceSize = 0) const override;
+
+	/// @brief Create an incremental decoder for data produced by encode().
+	/// @return Decoder stream.
+	virtual I_CodecStream::SPtr createDecodeStream() const override;
 
 };
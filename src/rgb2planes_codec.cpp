@@ -20,60 +20,135 @@ RgbToPlanes * RgbToPlanes::Create()
 	return new RgbToPlanes();
 }
 
-std::vector<uint8_t> RgbToPlanes::encode(const std::vector<uint8_t> & source) const
+size_t RgbToPlanes::encodeBound(size_t size) const
 {
-	const uint32_t srcSize = static_cast<uint32_t>(source.size());
-	if (srcSize > 0)
+	return size;
+}
+
+size_t RgbToPlanes::encodeInto(const uint8_t * source, size_t size, uint8_t * dest, size_t destSize, Workspace & /*workspace*/) const
+{
+	const size_t srcSize = size;
+	if (srcSize > 0 && destSize >= srcSize)
 	{
-		std::vector<uint8_t> dest(srcSize);
-		uint32_t destIndex = 0;
+		size_t destIndex = 0;
 		//the count must be divisible by three because we separate the RGB planes
 		if (srcSize % 3 == 0)
 		{
-			const uint32_t planeSize = srcSize / 3;
-			const uint32_t greenStart = planeSize;
-			const uint32_t blueStart = 2 * planeSize;
-			for (uint32_t srcIndex = 0; srcIndex < srcSize; ++destIndex, srcIndex += 3)
+			const size_t planeSize = srcSize / 3;
+			const size_t greenStart = planeSize;
+			const size_t blueStart = 2 * planeSize;
+			for (size_t srcIndex = 0; srcIndex < srcSize; ++destIndex, srcIndex += 3)
 			{
 				dest[destIndex] = source[srcIndex];
 				dest[destIndex + greenStart] = source[srcIndex + 1];
 				dest[destIndex + blueStart] = source[srcIndex + 2];
 			}
-			return dest;
 		}
 		else
 		{
-			return source;
+			std::memcpy(dest, source, srcSize);
 		}
+		return srcSize;
 	}
-	return std::vector<uint8_t>();
+	return 0;
 }
 
-std::vector<uint8_t> RgbToPlanes::decode(const std::vector<uint8_t> & source) const
+size_t RgbToPlanes::decodedSize(const uint8_t * /*source*/, size_t size) const
 {
-	const uint32_t srcSize = static_cast<uint32_t>(source.size());
-	if (srcSize > 0)
+	return size;
+}
+
+size_t RgbToPlanes::decodeInto(const uint8_t * source, size_t size, uint8_t * dest, size_t destSize, Workspace & /*workspace*/) const
+{
+	const size_t srcSize = size;
+	if (srcSize > 0 && destSize >= srcSize)
 	{
-		std::vector<uint8_t> dest(srcSize);
-		uint32_t srcIndex = 0;
+		size_t srcIndex = 0;
 		//the count must be divisible by three because we separate the RGB planes
 		if (srcSize % 3 == 0)
 		{
-			const uint32_t planeSize = srcSize / 3;
-			const uint32_t greenStart = planeSize;
-			const uint32_t blueStart = 2 * planeSize;
-			for (uint32_t destIndex = 0; destIndex < srcSize; ++srcIndex, destIndex += 3)
+			const size_t planeSize = srcSize / 3;
+			const size_t greenStart = planeSize;
+			const size_t blueStart = 2 * planeSize;
+			for (size_t destIndex = 0; destIndex < srcSize; ++srcIndex, destIndex += 3)
 			{
 				dest[destIndex] = source[srcIndex];
 				dest[destIndex + 1] = source[srcIndex + greenStart];
 				dest[destIndex + 2] = source[srcIndex + blueStart];
 			}
-			return dest;
 		}
 		else
 		{
-			return source;
+			std::memcpy(dest, source, srcSize);
+		}
+		return srcSize;
+	}
+	return 0;
+}
+
+/// @brief Incremental RGB to planes encoder. Outputs red values right away and collects green and blue values.
+/// If the source size is not divisible by 3 the data is passed through like encode() does.
+class RgbToPlanesEncodeStream : public I_CodecStream
+{
+public:
+	RgbToPlanesEncodeStream(uint64_t sourceSize)
+		: m_sourceSize(sourceSize), m_splitPlanes(sourceSize % 3 == 0)
+	{
+		if (m_splitPlanes)
+		{
+			m_green.reserve(static_cast<size_t>(sourceSize / 3));
+			m_blue.reserve(static_cast<size_t>(sourceSize / 3));
 		}
 	}
-	return std::vector<uint8_t>();
-}
\ No newline at end of file
+
+	virtual bool push(const uint8_t * data, size_t size, std::vector<uint8_t> & output) override
+	{
+		if (m_position + size > m_sourceSize)
+		{
+			return false;
+		}
+		for (size_t i = 0; i < size; ++i, ++m_position)
+		{
+			const uint32_t plane = m_splitPlanes ? m_position % 3 : 0;
+			if (plane == 0)
+			{
+				output.push_back(data[i]);
+			}
+			else if (plane == 1)
+			{
+				m_green.push_back(data[i]);
+			}
+			else
+			{
+				m_blue.push_back(data[i]);
+			}
+		}
+		return true;
+	}
+
+	virtual bool finish(std::vector<uint8_t> & output) override
+	{
+		output.insert(output.end(), m_green.cbegin(), m_green.cend());
+		output.insert(output.end(), m_blue.cbegin(), m_blue.cend());
+		m_green.clear();
+		m_blue.clear();
+		return m_position == m_sourceSize;
+	}
+
+private:
+	const uint64_t m_sourceSize;
+	const bool m_splitPlanes;
+	uint64_t m_position = 0;
+	std::vector<uint8_t> m_green;
+	std::vector<uint8_t> m_blue;
+};
+
+I_CodecStream::SPtr RgbToPlanes::createEncodeStream(uint64_t sourceSize) const
+{
+	//we need to know the plane size to do anything useful
+	if (sourceSize == 0)
+	{
+		return I_Codec::createEncodeStream(sourceSize);
+	}
+	return std::make_shared<RgbToPlanesEncodeStream>(sourceSize);
+}
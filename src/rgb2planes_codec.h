@@ -22,14 +22,39 @@ public:
 	/// @return Codec name.
 	virtual std::string codecName() const override;
 
+	/// @brief Worst-case size of the data encodeInto() produces with the current settings.
+	/// @param size Size of source data.
+	/// @return Returns size, as the conversion does not change the size of data.
+	virtual size_t encodeBound(size_t size) const override;
+
 	/// @brief Converts RGBRGBRGB... data to RRR...GGG...BBB... data format for better compression.
-	/// @param source Source data. Must be power of 3, else a 1to1 copy is made instead.
-	/// @return Returns compressed data.
-	virtual std::vector<uint8_t> encode(const std::vector<uint8_t> & source) const override;
+	/// @param source Pointer to source data.
+	/// @param size Size of source data. Must be divisible by 3, else a 1to1 copy is made instead.
+	/// @param dest Pointer to destination buffer.
+	/// @param destSize Size of destination buffer. Must be at least encodeBound(size).
+	/// @param workspace Scratch memory reused across calls.
+	/// @return Number of bytes written to dest. 0 if encoding failed.
+	virtual size_t encodeInto(const uint8_t * source, size_t size, uint8_t * dest, size_t destSize, Workspace & workspace) const override;
+
+	/// @brief Size of the data decodeInto() produces.
+	/// @param source Pointer to compressed data.
+	/// @param size Size of compressed data.
+	/// @return Returns size, as the conversion does not change the size of data.
+	virtual size_t decodedSize(const uint8_t * source, size_t size) const override;
 
 	/// @brief Converts RRR...GGG...BBB... plane data to RGBRGBRGB... data format.
-	/// @param source Source data. Must be power of 3, else a 1to1 copy is made instead.
-	/// @return Returns decompressed data.
-	virtual std::vector<uint8_t> decode(const std::vector<uint8_t> & source) const override;
+	/// @param source Pointer to compressed data.
+	/// @param size Size of compressed data. Must be divisible by 3, else a 1to1 copy is made instead.
+	/// @param dest Pointer to destination buffer.
+	/// @param destSize Size of destination buffer. Must be at least decodedSize(source, size).
+	/// @param workspace Scratch memory reused across calls.
+	/// @return Number of bytes written to dest. 0 if decoding failed.
+	virtual size_t decodeInto(const uint8_t * source, size_t size, uint8_t * dest, size_t destSize, Workspace & workspace) const override;
+
+	/// @brief Create an incremental encoder producing the same output as encode().
+	/// The red plane is output right away, the green and blue planes are held until finish().
+	/// @param sourceSize Total size of input. If 0 (unknown) all input is held until finish().
+	/// @return Encoder stream.
+	virtual I_CodecStream::SPtr createEncodeStream(uint64_t sourceSize = 0) const override;
 
 };
\ No newline at end of file
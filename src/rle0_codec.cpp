@@ -26,34 +26,36 @@ Rle0 * Rle0::Create()
 	return new Rle0();
 }
 
-std::vector<uint8_t> Rle0::encode(const std::vector<uint8_t> & source) const
+size_t Rle0::encodeBound(size_t size) const
 {
-	const uint32_t srcSize = static_cast<uint32_t>(source.size());
-	if (srcSize > 0)
+	//size + mode + unneeded symbol + 3 bytes for every 2 symbols
+	return Tools::MaxSizeBytes + 1 + 1 + size + (size + 1) / 2;
+}
+
+size_t Rle0::encodeInto(const uint8_t * source, size_t size, uint8_t * dest, size_t destSize, Workspace & /*workspace*/) const
+{
+	const size_t srcSize = size;
+	if (srcSize > 0 && destSize >= encodeBound(srcSize))
 	{
-		std::vector<uint8_t> dest(srcSize + srcSize / 2 + 4 + 1 + 1);
-		uint32_t destIndex = 0;
-		uint32_t srcIndex = 0;
+		size_t destIndex = 0;
+		size_t srcIndex = 0;
 		//output source size
-		*((uint32_t *)&dest[destIndex]) = srcSize;
-		destIndex += 4;
+		Tools::writeSize(dest, destIndex, srcSize);
 		//check which symbols do not occur in data
-		std::array<std::pair<uint8_t, uint32_t>, 256> frequencies;
+		std::array<uint64_t, 256> counts;
+		Tools::histogram(source, srcSize, counts.data(), threadCount());
+		std::array<std::pair<uint8_t, uint64_t>, 256> frequencies;
 		for (uint32_t i = 0; i < frequencies.size(); ++i)
 		{
 			frequencies[i].first = i;
-			frequencies[i].second = 0;
-		}
-		for (auto symbol : source)
-		{
-			frequencies[symbol].second++;
+			frequencies[i].second = counts[i];
 		}
 		//sort by count
-		std::sort(frequencies.begin(), frequencies.end(), [](const std::pair<uint8_t, uint32_t> & a, const std::pair<uint8_t, uint32_t> & b)
+		std::sort(frequencies.begin(), frequencies.end(), [](const std::pair<uint8_t, uint64_t> & a, const std::pair<uint8_t, uint64_t> & b)
 																			 { return a.second > b.second; });
 		//check if we have two free symbols to mark a run of zeros (0 and 1)
 		//we add 1 to every byte in the data stream to free up 1, thus the one extra symbol needs to be free
-		auto unneededSymbol = std::find_if(frequencies.cbegin(), frequencies.cend(), [](const std::pair<uint8_t, uint32_t> & n){ return n.first > 0 && n.second == 0; });
+		auto unneededSymbol = std::find_if(frequencies.cbegin(), frequencies.cend(), [](const std::pair<uint8_t, uint64_t> & n){ return n.first > 0 && n.second == 0; });
 		if (unneededSymbol != frequencies.cend())
 		{
 			if (m_verbose) std::cout << "Using Wheeler zero run length encoding." << std::endl;
@@ -114,24 +116,27 @@ std::vector<uint8_t> Rle0::encode(const std::vector<uint8_t> & source) const
 				}
 			}
 		}
-		dest.resize(destIndex);
-		return dest;
+		return destIndex;
 	}
-	return std::vector<uint8_t>();
+	return 0;
 }
 
-std::vector<uint8_t> Rle0::decode(const std::vector<uint8_t> & source) const
+size_t Rle0::decodedSize(const uint8_t * source, size_t size) const
 {
-	const uint32_t srcSize = static_cast<uint32_t>(source.size());
-	if (srcSize > 0)
+	size_t srcIndex = 0;
+	uint64_t destSize = 0;
+	return Tools::readSize(source, size, srcIndex, destSize) ? static_cast<size_t>(destSize) : 0;
+}
+
+size_t Rle0::decodeInto(const uint8_t * source, size_t size, uint8_t * dest, size_t destCapacity, Workspace & /*workspace*/) const
+{
+	const size_t srcSize = size;
+	//read result size
+	size_t srcIndex = 0;
+	uint64_t destSize = 0;
+	if (Tools::readSize(source, srcSize, srcIndex, destSize) && destSize <= destCapacity && srcIndex < srcSize)
 	{
-		//read result size
-		uint32_t srcIndex = 0;
-		const uint32_t destSize = *((uint32_t *)&source[srcIndex]);
-		srcIndex += 4;
-		//allocate destination data
-		std::vector<uint8_t> dest(destSize);
-		uint32_t destIndex = 0;
+		size_t destIndex = 0;
 		//read compression mode used
 		const uint8_t mode = source[srcIndex++];
 		if (mode == 0)
@@ -147,14 +152,18 @@ std::vector<uint8_t> Rle0::decode(const std::vector<uint8_t> & source) const
 				if (symbol == 0)
 				{
 					//write run of zeros
-					uint32_t count = source[srcIndex++];
+					uint32_t count = srcIndex < srcSize ? source[srcIndex++] : 0;
+					if (destIndex + count > destSize)
+					{
+						return 0;
+					}
 					for (uint32_t i = 0; i < count; ++i)
 					{
 						dest[destIndex++] = 0;
 					}
 				}
 			}
-			return dest;
+			return destIndex == destSize ? destIndex : 0;
 		}
 		else if (mode == 1)
 		{
@@ -178,6 +187,10 @@ std::vector<uint8_t> Rle0::decode(const std::vector<uint8_t> & source) const
 					}
 					//now decrease count by 1
 					count--;
+					if (destIndex + count > destSize)
+					{
+						return 0;
+					}
 					//write length zeros to destination
 					for (uint32_t i = 0; i < count; ++i)
 					{
@@ -190,8 +203,128 @@ std::vector<uint8_t> Rle0::decode(const std::vector<uint8_t> & source) const
 					dest[destIndex++] = symbol <= symbolBorder ? symbol - 1 : symbol;
 				}
 			}
-			return dest;
+			return destIndex == destSize ? destIndex : 0;
+		}
+	}
+	return 0;
+}
+
+/// @brief Incremental zero run-length decoder. Runs of zeros may span multiple chunks of input.
+class Rle0DecodeStream : public I_CodecStream
+{
+public:
+	virtual bool push(const uint8_t * data, size_t size, std::vector<uint8_t> & output) override
+	{
+		for (size_t i = 0; i < size; ++i)
+		{
+			const uint8_t symbol = data[i];
+			if (!m_headerRead)
+			{
+				//collect header bytes until we have the size, the mode and the unneeded symbol
+				m_header.push_back(symbol);
+				size_t index = 0;
+				uint64_t destSize = 0;
+				if (Tools::readSize(m_header.data(), m_header.size(), index, destSize) && index < m_header.size())
+				{
+					m_destSize = destSize;
+					m_mode = m_header[index++];
+					if (m_mode > 1)
+					{
+						return false;
+					}
+					if (m_mode == 0 || index < m_header.size())
+					{
+						m_symbolBorder = m_mode == 1 ? m_header[index] : 0;
+						m_headerRead = true;
+						m_header.clear();
+					}
+				}
+			}
+			else if (m_mode == 0)
+			{
+				if (m_zeroRead)
+				{
+					//symbol is the number of zeros following the first one
+					if (!outputSymbols(0, symbol, output))
+					{
+						return false;
+					}
+					m_zeroRead = false;
+				}
+				else
+				{
+					if (!outputSymbols(symbol, 1, output))
+					{
+						return false;
+					}
+					m_zeroRead = symbol == 0;
+				}
+			}
+			else
+			{
+				if (symbol < 2)
+				{
+					//encoded zero run. restore one MSB and add first bit or add further bits
+					m_runCount = m_runCount == 0 ? (2 | symbol) : ((m_runCount << 1) | symbol);
+				}
+				else
+				{
+					//verbatim byte. flush run of zeros first
+					if (!flushRun(output) || !outputSymbols(symbol <= m_symbolBorder ? symbol - 1 : symbol, 1, output))
+					{
+						return false;
+					}
+				}
+			}
 		}
+		return true;
 	}
-	return std::vector<uint8_t>();
+
+	virtual bool finish(std::vector<uint8_t> & output) override
+	{
+		//no input at all is fine, as encode() produces no output for empty data
+		if (!m_headerRead)
+		{
+			return m_header.empty();
+		}
+		return flushRun(output) && m_destIndex == m_destSize;
+	}
+
+private:
+	bool flushRun(std::vector<uint8_t> & output)
+	{
+		if (m_runCount > 0)
+		{
+			//decrease count by 1 and write zeros
+			const uint64_t count = m_runCount - 1;
+			m_runCount = 0;
+			return outputSymbols(0, count, output);
+		}
+		return true;
+	}
+
+	bool outputSymbols(uint8_t symbol, uint64_t count, std::vector<uint8_t> & output)
+	{
+		if (m_destIndex + count > m_destSize)
+		{
+			return false;
+		}
+		output.insert(output.end(), static_cast<size_t>(count), symbol);
+		m_destIndex += count;
+		return true;
+	}
+
+	std::vector<uint8_t> m_header;
+	bool m_headerRead = false;
+	uint64_t m_destSize = 0;
+	uint64_t m_destIndex = 0;
+	uint8_t m_mode = 0;
+	uint8_t m_symbolBorder = 0;
+	bool m_zeroRead = false;
+	uint64_t m_runCount = 0;
+};
+
+I_CodecStream::SPtr Rle0::createDecodeStream() const
+{
+	return std::make_shared<Rle0DecodeStream>();
 }
@@ -22,16 +22,40 @@ public:
 	/// @return Codec name.
 	virtual std::string codecName() const override;
 
+	/// @brief Worst-case size of the data encodeInto() produces with the current settings.
+	/// @param size Size of source data.
+	/// @return Returns the size of header data plus 1.5 * size for the worst case of all zeros being single.
+	virtual size_t encodeBound(size_t size) const override;
+
 	/// @brief Apply zero run-length encoding to data. This is note the proposed Wheeler variant, but the naive one.
 	/// A run of zeros is encoded as a zero and the repetition count minus 1. Runs are no longer than 255 bytes.
 	/// Other symbols are simply copied to output. Thus a single zero is encoded as 0,0. A run of 2 zeros as 0,1 and so on.
-	/// @param source Source data.
-	/// @return Returns compressed data.
-	virtual std::vector<uint8_t> encode(const std::vector<uint8_t> & source) const override;
+	/// @param source Pointer to source data.
+	/// @param size Size of source data.
+	/// @param dest Pointer to destination buffer.
+	/// @param destSize Size of destination buffer. Must be at least encodeBound(size).
+	/// @param workspace Scratch memory reused across calls.
+	/// @return Number of bytes written to dest. 0 if encoding failed.
+	virtual size_t encodeInto(const uint8_t * source, size_t size, uint8_t * dest, size_t destSize, Workspace & workspace) const override;
+
+	/// @brief Size of the data decodeInto() produces.
+	/// @param source Pointer to compressed data.
+	/// @param size Size of compressed data.
+	/// @return Returns the size stored in the header of the compressed data. 0 if the size could not be determined.
+	virtual size_t decodedSize(const uint8_t * source, size_t size) const override;
 
 	/// @brief Apply reverse zero run-length encoding to data. This is NOT the Wheeler variant, but the naive one.
-	/// @param source Source data.
-	/// @return Returns decompressed data.
-	virtual std::vector<uint8_t> decode(const std::vector<uint8_t> & source) const override;
+	/// @param source Pointer to compressed data.
+	/// @param size Size of compressed data.
+	/// @param dest Pointer to destination buffer.
+	/// @param destSize Size of destination buffer. Must be at least decodedSize(source, size).
+	/// @param workspace Scratch memory reused across calls.
+	/// @return Number of bytes written to dest. 0 if decoding failed.
+	virtual size_t decodeInto(const uint8_t * source, size_t size, uint8_t * dest, size_t destSize, Workspace & workspace) const override;
+
+	/// @brief Create an incremental decoder producing the same output as decode().
+	/// @return Decoder stream.
+	/// @note There is no incremental encoder, because encode() needs the symbol frequencies of all data to select the encoding mode.
+	virtual I_CodecStream::SPtr createDecodeStream() const override;
 
 };
\ No newline at end of file
@@ -1,6 +1,14 @@
 #include "tools.h"
 
 #include <inttypes.h>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <limits>
+
+#if defined(_MSC_VER)
+	#include <intrin.h>
+#endif
 
 
 namespace Tools
@@ -28,13 +36,32 @@ namespace Tools
 		return result;
 	}
 
+	uint32_t lowestBitSet(uint64_t value)
+	{
+#if defined(__GNUC__) || defined(__clang__)
+		return static_cast<uint32_t>(__builtin_ctzll(value));
+#elif defined(_MSC_VER) && defined(_M_X64)
+		unsigned long result;
+		_BitScanForward64(&result, value);
+		return result;
+#else
+		uint32_t result = 0;
+		while ((value & 1) == 0)
+		{
+			value >>= 1;
+			++result;
+		}
+		return result;
+#endif
+	}
+
 	/// See: https://en.wikipedia.org/wiki/Adler-32
-	uint32_t calculateAdler32(const std::vector<uint8_t> & data, uint32_t adler)
+	uint32_t calculateAdler32(const uint8_t * data, size_t size, uint32_t adler)
 	{
 		uint32_t s1 = adler & 0xffff;
 		uint32_t s2 = (adler >> 16) & 0xffff;
 		//calculate checksum for buffer
-		for (uint32_t n = 0; n < data.size(); ++n)
+		for (size_t n = 0; n < size; ++n)
 		{
 			s1 = (s1 + data[n]) % 65521;
 			s2 = (s2 + s1) % 65521;
@@ -43,7 +70,43 @@ namespace Tools
 		return (s2 << 16) + s1;
 	}
 
-	void outputBits(std::vector<uint8_t> & dest, uint32_t & index, uint32_t & buffer, uint32_t & bufferBits, bool dumpRemaining)
+	void writeSize(uint8_t * dest, size_t & index, uint64_t size)
+	{
+		if (size < 0xFFFFFFFF)
+		{
+			*((uint32_t *)&dest[index]) = static_cast<uint32_t>(size);
+			index += 4;
+		}
+		else
+		{
+			*((uint32_t *)&dest[index]) = 0xFFFFFFFF;
+			index += 4;
+			*((uint64_t *)&dest[index]) = size;
+			index += 8;
+		}
+	}
+
+	bool readSize(const uint8_t * source, size_t sourceSize, size_t & index, uint64_t & size)
+	{
+		if (index + 4 > sourceSize)
+		{
+			return false;
+		}
+		size = *((uint32_t *)&source[index]);
+		index += 4;
+		if (size == 0xFFFFFFFF)
+		{
+			if (index + 8 > sourceSize)
+			{
+				return false;
+			}
+			size = *((uint64_t *)&source[index]);
+			index += 8;
+		}
+		return size <= std::numeric_limits<size_t>::max();
+	}
+
+	void outputBits(uint8_t * dest, size_t & index, uint32_t & buffer, uint32_t & bufferBits, bool dumpRemaining)
 	{
 		//if the buffer has a short or byte available, output it
 		while (bufferBits <= 24)
@@ -59,4 +122,130 @@ namespace Tools
 		}
 	}
 
+	/// @brief Add the byte counts of data to counts.
+	static void addHistogram(const uint8_t * data, size_t size, uint64_t * counts)
+	{
+		uint32_t tables[8][256];
+		while (size > 0)
+		{
+			//count in pieces, so the 32-bit counters can not overflow
+			const size_t pieceSize = std::min<size_t>(size, size_t(1) << 30);
+			const uint8_t * end = data + pieceSize;
+			std::memset(tables, 0, sizeof(tables));
+			//count 16 bytes per iteration. the byte order of the loads does not matter for counting
+			for (; end - data >= 16; data += 16)
+			{
+				uint64_t a;
+				uint64_t b;
+				std::memcpy(&a, data, 8);
+				std::memcpy(&b, data + 8, 8);
+				tables[0][a & 0xFF]++;
+				tables[1][(a >> 8) & 0xFF]++;
+				tables[2][(a >> 16) & 0xFF]++;
+				tables[3][(a >> 24) & 0xFF]++;
+				tables[4][(a >> 32) & 0xFF]++;
+				tables[5][(a >> 40) & 0xFF]++;
+				tables[6][(a >> 48) & 0xFF]++;
+				tables[7][a >> 56]++;
+				tables[0][b & 0xFF]++;
+				tables[1][(b >> 8) & 0xFF]++;
+				tables[2][(b >> 16) & 0xFF]++;
+				tables[3][(b >> 24) & 0xFF]++;
+				tables[4][(b >> 32) & 0xFF]++;
+				tables[5][(b >> 40) & 0xFF]++;
+				tables[6][(b >> 48) & 0xFF]++;
+				tables[7][b >> 56]++;
+			}
+			for (; data < end; ++data)
+			{
+				tables[0][*data]++;
+			}
+			for (uint32_t i = 0; i < 256; ++i)
+			{
+				counts[i] += static_cast<uint64_t>(tables[0][i]) + tables[1][i] + tables[2][i] + tables[3][i] +
+					tables[4][i] + tables[5][i] + tables[6][i] + tables[7][i];
+			}
+			size -= pieceSize;
+		}
+	}
+
+	void histogram(const uint8_t * data, size_t size, uint64_t * counts, uint32_t threadCount)
+	{
+		std::fill_n(counts, 256, 0);
+		const uint32_t nrOfThreads = parallelThreadCount(static_cast<uint32_t>(std::min<uint64_t>(threadCount, size / HistogramBytesPerThread)), threadCount);
+		if (nrOfThreads <= 1)
+		{
+			addHistogram(data, size, counts);
+			return;
+		}
+		//count parts of the data on all threads and add up the results
+		std::vector<uint64_t> partCounts(nrOfThreads * 256, 0);
+		const size_t partSize = (size + nrOfThreads - 1) / nrOfThreads;
+		parallelFor(nrOfThreads, nrOfThreads, [&](uint32_t part, uint32_t /*threadIndex*/)
+		{
+			const size_t start = part * partSize;
+			if (start < size)
+			{
+				addHistogram(data + start, std::min(partSize, size - start), partCounts.data() + part * 256);
+			}
+		});
+		for (uint32_t part = 0; part < nrOfThreads; ++part)
+		{
+			for (uint32_t i = 0; i < 256; ++i)
+			{
+				counts[i] += partCounts[part * 256 + i];
+			}
+		}
+	}
+
+	uint32_t hardwareThreadCount()
+	{
+		const uint32_t count = std::thread::hardware_concurrency();
+		return count > 0 ? count : 1;
+	}
+
+	//set for threads that are currently running work items. nested loops run serially on those
+	static thread_local bool insideParallelFor = false;
+
+	uint32_t parallelThreadCount(uint32_t count, uint32_t threadCount)
+	{
+		return insideParallelFor ? 1 : std::max(std::min(threadCount, count), 1u);
+	}
+
+	void parallelFor(uint32_t count, uint32_t threadCount, const std::function<void(uint32_t index, uint32_t threadIndex)> & work)
+	{
+		threadCount = parallelThreadCount(count, threadCount);
+		if (threadCount <= 1)
+		{
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				work(i, 0);
+			}
+			return;
+		}
+		//hand out work items to threads until none are left
+		std::atomic<uint32_t> nextIndex(0);
+		auto worker = [&](uint32_t threadIndex)
+		{
+			insideParallelFor = true;
+			uint32_t index;
+			while ((index = nextIndex++) < count)
+			{
+				work(index, threadIndex);
+			}
+			insideParallelFor = false;
+		};
+		//start additional threads and let the calling thread do work too
+		std::vector<std::thread> threads;
+		for (uint32_t i = 1; i < threadCount; ++i)
+		{
+			threads.push_back(std::thread(worker, i));
+		}
+		worker(0);
+		for (auto & thread : threads)
+		{
+			thread.join();
+		}
+	}
+
 }
\ No newline at end of file
@@ -1,7 +1,14 @@
 #pragma once
 
 #include <inttypes.h>
+#include <cstddef>
 #include <vector>
+#include <functional>
+#include <cstring>
+
+#if defined(_MSC_VER)
+	#include <stdlib.h>
+#endif
 
 
 namespace Tools
@@ -9,11 +16,30 @@ namespace Tools
 
 	/// @brief Create Adler-32 checksum from data.
 	/// @param data Data to create checksum for.
+	/// @param size Size of data.
 	/// @param adler Optional. Adler checksum from last run if you're combining data.
 	/// @return Returns the Adler-32 checksum for the data or the initial checksum upon failure.
 	/// @note Based on the sample code here: https://tools.ietf.org/html/rfc1950. 
 	/// This is not as safe as CRC-32 (see here: https://en.wikipedia.org/wiki/Adler-32), but should be totally sufficient for us.
-	uint32_t calculateAdler32(const std::vector<uint8_t> & dest, uint32_t adler = 1);
+	uint32_t calculateAdler32(const uint8_t * data, size_t size, uint32_t adler = 1);
+
+	/// @brief Maximum number of bytes writeSize() will write.
+	const uint32_t MaxSizeBytes = 12;
+
+	/// @brief Write a data size to a codec header. Sizes < 0xFFFFFFFF are stored as a 4-byte value like in older versions.
+	/// Bigger sizes are stored as 0xFFFFFFFF followed by the size as an 8-byte value.
+	/// @param dest Destination data. Must have room for MaxSizeBytes bytes at index.
+	/// @param index Index in dest array for start of output. Will be increased by the number of bytes written.
+	/// @param size Size to store.
+	void writeSize(uint8_t * dest, size_t & index, uint64_t size);
+
+	/// @brief Read a data size written by writeSize() from a codec header.
+	/// @param source Source data.
+	/// @param sourceSize Size of source data.
+	/// @param index Index in source array for start of input. Will be increased by the number of bytes read.
+	/// @param size Size read from data.
+	/// @return Returns false if there was not enough data to read the size or the size doesn't fit into memory.
+	bool readSize(const uint8_t * source, size_t sourceSize, size_t & index, uint64_t & size);
 
 	/// @brief Calculate integer log2 of value rounded up.
 	/// @param value Input value.
@@ -25,6 +51,163 @@ namespace Tools
 	/// @return Return the highest bit set to 1 (0-31).
 	uint32_t highestBitSet(uint32_t value);
 
+	/// @brief Lowest bit position set to 1 in the value, also known as count trailing zeros.
+	/// @param value Input value. Must not be 0.
+	/// @return Return the lowest bit set to 1 (0-63).
+	uint32_t lowestBitSet(uint64_t value);
+
+	/// @brief Read 8 bytes from unaligned memory as big-endian value, so the first byte ends up in the top bits.
+	/// Used for bit readers that refill their buffer with a single load.
+	/// @param data Pointer to data. 8 bytes must be readable.
+	/// @return Returns the big-endian value.
+	inline uint64_t readBigEndian64(const uint8_t * data)
+	{
+		uint64_t value;
+		std::memcpy(&value, data, 8);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+		return value;
+#elif defined(__GNUC__) || defined(__clang__)
+		return __builtin_bswap64(value);
+#elif defined(_MSC_VER)
+		return _byteswap_uint64(value);
+#else
+		return ((value & 0xFF) << 56) | ((value & 0xFF00) << 40) | ((value & 0xFF0000) << 24) | ((value & 0xFF000000) << 8) |
+			((value >> 8) & 0xFF000000) | ((value >> 24) & 0xFF0000) | ((value >> 40) & 0xFF00) | (value >> 56);
+#endif
+	}
+
+	/// @brief MSB-first bit reader with a 64-bit buffer. Refills with a single unaligned 8-byte load
+	/// while at least 8 bytes of input are left and byte by byte at the end of the data.
+	/// Reading past the end of the data returns zero bits and sets overrun().
+	class BitReader
+	{
+	public:
+		BitReader() {}
+		BitReader(const uint8_t * data, size_t size) : m_in(data), m_end(data + size) {}
+
+		/// @brief Make sure the buffer holds at least 56 bits, if there is enough data.
+		void refill()
+		{
+			if (m_end - m_in >= 8)
+			{
+				//read 8 bytes at once, but only keep the bytes that fit into the buffer
+				m_buffer |= readBigEndian64(m_in) >> m_bits;
+				m_in += (63 - m_bits) >> 3;
+				m_bits |= 56;
+			}
+			else
+			{
+				while (m_bits <= 56 && m_in < m_end)
+				{
+					m_buffer |= static_cast<uint64_t>(*m_in++) << (56 - m_bits);
+					m_bits += 8;
+				}
+			}
+		}
+
+		/// @brief Look at the next count bits [1,32] without removing them.
+		uint32_t peek(uint32_t count) const
+		{
+			return static_cast<uint32_t>(m_buffer >> (64 - count));
+		}
+
+		/// @brief Remove count bits [0,56] from the buffer.
+		void skip(uint32_t count)
+		{
+			m_buffer <<= count;
+			m_bits -= static_cast<int32_t>(count);
+		}
+
+		/// @brief Read and remove count bits [0,32].
+		uint32_t get(uint32_t count)
+		{
+			if (count == 0)
+			{
+				return 0;
+			}
+			const uint32_t value = peek(count);
+			skip(count);
+			return value;
+		}
+
+		/// @brief True if more bits were read than the data has.
+		bool overrun() const
+		{
+			return m_bits < 0;
+		}
+
+	private:
+		const uint8_t * m_in = nullptr;
+		const uint8_t * m_end = nullptr;
+		uint64_t m_buffer = 0;
+		int32_t m_bits = 0;
+	};
+
+	/// @brief Copy a match of an LZ decoder to out. Copies in chunks of 8 or 16 bytes that may write up to 15 bytes past the end
+	/// of the match while that stays in front of outEnd, and byte by byte close to outEnd. Overlapping matches repeat their pattern.
+	/// @param out Position to copy the match to.
+	/// @param offset Distance of the match source before out. Must be in [1, number of bytes in front of out].
+	/// @param length Length of the match. Must be <= outEnd - out.
+	/// @param outEnd End of the destination buffer. Nothing is written at or behind it.
+	/// @return Returns out + length.
+	inline uint8_t * copyMatch(uint8_t * out, size_t offset, size_t length, const uint8_t * outEnd)
+	{
+		const uint8_t * match = out - offset;
+		uint8_t * matchEnd = out + length;
+		if (outEnd - matchEnd >= 16)
+		{
+			// we can write past the end of the match. copy in chunks that don't overlap their source
+			if (offset >= 16)
+			{
+				do
+				{
+					std::memcpy(out, match, 16);
+					out += 16;
+					match += 16;
+				} while (out < matchEnd);
+			}
+			else
+			{
+				if (offset < 8)
+				{
+					// repeat the pattern of offset bytes until it is 8 bytes long. a multiple of the offset is a valid offset too
+					for (int i = 0; i < 8; ++i)
+					{
+						out[i] = match[i];
+					}
+					out += 8;
+					match = out - offset * ((8 + offset - 1) / offset);
+				}
+				while (out < matchEnd)
+				{
+					std::memcpy(out, match, 8);
+					out += 8;
+					match += 8;
+				}
+			}
+		}
+		else
+		{
+			// close to the end of dest. copy byte by byte
+			while (out < matchEnd)
+			{
+				*out++ = *match++;
+			}
+		}
+		return matchEnd;
+	}
+
+	/// @brief Minimum number of bytes histogram() counts per thread. Smaller data is counted on fewer threads.
+	const size_t HistogramBytesPerThread = 1024 * 1024;
+
+	/// @brief Count how often every byte value occurs in data. Reads 8 bytes at once and counts every byte of them into its own table,
+	/// so runs of the same byte don't have to wait for the previous increment of the same counter.
+	/// @param data Data to count.
+	/// @param size Size of data.
+	/// @param counts Counts of all 256 byte values. Must have room for 256 values. Will be overwritten.
+	/// @param threadCount Optional. Maximum number of threads to use, including the calling thread.
+	void histogram(const uint8_t * data, size_t size, uint64_t * counts, uint32_t threadCount = 1);
+
 	/// @brief Write bits from buffer into dest starting at index.
 	/// @param dest Point to destination.
 	/// @param index Index in dest array for start of output.
@@ -32,6 +215,25 @@ namespace Tools
 	/// @param availableBits Free bits available in the buffer. Output will occur if avaiableBits <= 24.
 	/// @param dumpRemaining Pass true to dump all remaining bits to output by dumping a full byte if needed.
 	/// The excess bits might contain random data.
-	void outputBits(std::vector<uint8_t> & dest, uint32_t & index, uint32_t & buffer, uint32_t & availableBits, bool dumpRemaining = false);
+	void outputBits(uint8_t * dest, size_t & index, uint32_t & buffer, uint32_t & availableBits, bool dumpRemaining = false);
+
+	/// @brief Number of threads available on this machine.
+	/// @return Returns the number of hardware threads or 1 if that can not be determined.
+	uint32_t hardwareThreadCount();
+
+	/// @brief Number of threads parallelFor() will use for a loop.
+	/// @param count Number of work items.
+	/// @param threadCount Maximum number of threads to use, including the calling thread.
+	/// @return Returns the number of threads in [1, threadCount]. 1 when called from inside a work function.
+	uint32_t parallelThreadCount(uint32_t count, uint32_t threadCount);
+
+	/// @brief Call work(index, threadIndex) for all indices in [0, count) using up to threadCount threads.
+	/// Indices are handed out to the threads in ascending order. The function returns when all work is done.
+	/// @param count Number of work items.
+	/// @param threadCount Maximum number of threads to use, including the calling thread.
+	/// @param work Function to call for every work item index. Must be safe to call from multiple threads.
+	/// It is passed the index of the thread running it in [0, threadCount), e.g. for using per-thread memory.
+	/// @note Calls from inside a work function run on the calling thread only, so nested loops don't oversubscribe the machine.
+	void parallelFor(uint32_t count, uint32_t threadCount, const std::function<void(uint32_t index, uint32_t threadIndex)> & work);
 
 }
\ No newline at end of file
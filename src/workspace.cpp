@@ -0,0 +1,32 @@
+#include "workspace.h"
+
+
+uint8_t * Workspace::getBytes(uint32_t slot, size_t size)
+{
+	if (slot >= m_slots.size())
+	{
+		m_slots.resize(slot + 1);
+	}
+	std::vector<uint8_t> & memory = m_slots[slot];
+	if (memory.size() < size)
+	{
+		//grow without copying the old contents, they are undefined anyway
+		std::vector<uint8_t>(size).swap(memory);
+	}
+	return memory.data();
+}
+
+size_t Workspace::size() const
+{
+	size_t result = 0;
+	for (const auto & memory : m_slots)
+	{
+		result += memory.size();
+	}
+	return result;
+}
+
+void Workspace::clear()
+{
+	m_slots.clear();
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <inttypes.h>
+#include <cstddef>
+#include <vector>
+
+
+/// @brief Scratch memory that codecs and the compressor reuse across calls, so encoding and decoding
+/// in steady state does not allocate memory. Memory is handed out in numbered slots. A slot keeps its memory
+/// until clear() is called and only grows when more memory is requested than it holds.
+/// @note A workspace must only be used by one thread and one codec at a time. Codecs number their slots starting from 0.
+class Workspace
+{
+public:
+	/// @brief Get the memory of a slot. The memory is aligned for all fundamental types.
+	/// @param slot Slot number.
+	/// @param count Number of elements of type T needed.
+	/// @return Pointer to memory for count elements. The contents are undefined.
+	template <typename T>
+	T * get(uint32_t slot, size_t count)
+	{
+		return reinterpret_cast<T *>(getBytes(slot, count * sizeof(T)));
+	}
+
+	/// @brief Number of bytes currently held by all slots.
+	/// @return Size of workspace in bytes.
+	size_t size() const;
+
+	/// @brief Release the memory of all slots.
+	void clear();
+
+private:
+	/// @brief Get the memory of a slot, growing it if needed.
+	uint8_t * getBytes(uint32_t slot, size_t size);
+
+	/// @brief Memory of all slots.
+	std::vector<std::vector<uint8_t>> m_slots;
+};